@@ -0,0 +1,277 @@
+#include <cv_bridge/cv_bridge.h>
+#include <rclcpp/rclcpp.hpp>
+#include <rclcpp_components/register_node_macro.hpp>
+#include <sensor_msgs/msg/compressed_image.hpp>
+#include <sensor_msgs/image_encodings.hpp>
+#include <sensor_msgs/msg/image.hpp>
+#include <tracing/trace.hpp>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace camera_view {
+
+// Frames are resized and encoded on a worker thread, so the spin thread only hands them over.
+// The worker holds at most one waiting frame: a frame arriving while another waits replaces it,
+// so under load the newest frame is sent and the older ones are dropped rather than queued.
+class CameraView: public rclcpp::Node {
+public:
+    const std::string camera_topic = "/truck/color/image_raw";
+    const std::string camera_view_topic = "/truck/color/image_view";
+
+    explicit CameraView(const rclcpp::NodeOptions& options) : Node("CameraView", options) {
+        tracing::start_from_env();
+
+        // Zero height keeps the aspect ratio of the camera.
+        width_ = declare_parameter<int>("width", 320);
+        height_ = declare_parameter<int>("height", 0);
+        // "jpeg" or "png", quality is the JPEG quality or the PNG compression level.
+        format_ = declare_parameter<std::string>("format", "jpeg");
+        const int quality = declare_parameter<int>("quality", format_ == "png" ? 3 : 95);
+        // Zero sends every frame the worker keeps up with.
+        const double max_rate_hz = declare_parameter<double>("max_rate_hz", 0.0);
+        // Zero leaves the stage timing log off.
+        const double stats_period_s = declare_parameter<double>("stats_period_s", 0.0);
+
+        if (format_ == "jpeg") {
+            extension_ = ".jpg";
+            encode_params_ = {cv::IMWRITE_JPEG_QUALITY, quality};
+        } else if (format_ == "png") {
+            extension_ = ".png";
+            encode_params_ = {cv::IMWRITE_PNG_COMPRESSION, quality};
+        } else {
+            throw std::invalid_argument("Unknown image format " + format_);
+        }
+        if (width_ <= 0 || height_ < 0) {
+            throw std::invalid_argument("Image width must be positive and height not negative");
+        }
+        if (max_rate_hz > 0.0) {
+            min_interval_ = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / max_rate_hz));
+        }
+        if (stats_period_s > 0.0) {
+            stats_period_ = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(stats_period_s));
+        }
+
+        const auto qos = rclcpp::QoS(
+            rclcpp::QoSInitialization::from_rmw(rmw_qos_profile_sensor_data),
+            rmw_qos_profile_sensor_data);
+
+        signal_camera_view_ =
+            this->create_publisher<sensor_msgs::msg::CompressedImage>(camera_view_topic, qos);
+
+        worker_ = std::thread(&CameraView::Work, this);
+
+        slot_camera_ = this->create_subscription<sensor_msgs::msg::Image>(
+            camera_topic, qos,
+            std::bind(&CameraView::Receive, this, std::placeholders::_1));
+    }
+
+    // Container unloads the component without a shutdown callback, so the worker is joined here.
+    ~CameraView() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopped_ = true;
+        }
+        wake_.notify_one();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Counts and time per stage since the last stats log. Every frame received is either skipped,
+    // throttled or empty, dropped for a newer one or published.
+    struct Stats {
+        uint64_t received = 0;
+        uint64_t skipped = 0;
+        uint64_t dropped = 0;
+        uint64_t published = 0;
+        uint64_t bytes = 0;
+        Clock::duration wait{};
+        Clock::duration resize{};
+        Clock::duration encode{};
+        Clock::duration publish{};
+    };
+
+    // Spin thread, keeps the message shared rather than copying the image.
+    void Receive(sensor_msgs::msg::Image::ConstSharedPtr msg) {
+        const auto now = Clock::now();
+        const uint64_t frame_id = rclcpp::Time(msg->header.stamp).nanoseconds();
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.received;
+        if (now - last_accepted_ < min_interval_) {
+            ++stats_.skipped;
+            return;
+        }
+        last_accepted_ = now;
+        if (pending_) {
+            ++stats_.dropped;
+            tracing::instant("image dropped", rclcpp::Time(pending_->header.stamp).nanoseconds());
+        }
+        pending_ = std::move(msg);
+        pending_since_ = now;
+        tracing::instant("image received", frame_id);
+        wake_.notify_one();
+    }
+
+    void Work() {
+        tracing::name_thread("camera view encoder");
+        auto stats_since = Clock::now();
+        while (true) {
+            sensor_msgs::msg::Image::ConstSharedPtr msg;
+            Clock::time_point queued;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this] { return stopped_ || pending_; });
+                if (stopped_) {
+                    return;
+                }
+                msg = std::move(pending_);
+                pending_.reset();
+                queued = pending_since_;
+            }
+            Process(msg, queued);
+
+            const auto now = Clock::now();
+            if (stats_period_ > Clock::duration::zero() && now - stats_since >= stats_period_) {
+                LogStats(now - stats_since);
+                stats_since = now;
+            }
+        }
+    }
+
+    void Process(const sensor_msgs::msg::Image::ConstSharedPtr& msg, Clock::time_point queued) {
+        // Frames are told apart by their capture time.
+        const uint64_t frame_id = rclcpp::Time(msg->header.stamp).nanoseconds();
+        const auto start = Clock::now();
+
+        const cv::Mat* image = nullptr;
+        {
+            tracing::Span span{"image resized", frame_id};
+            auto cv_image = cv_bridge::toCvShare(msg);
+            const cv::Size size = cv_image->image.size();
+            if (size.width == 0 || size.height == 0) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++stats_.skipped;
+                return;
+            }
+            const int height = height_ > 0 ? height_ : std::max(1, width_ * size.height / size.width);
+            // Reallocated only when the camera resolution or the encoding changes.
+            cv::resize(cv_image->image, resized_, {width_, height}, 0, 0, cv::INTER_NEAREST);
+            image = &ToBgr(*msg);
+        }
+        const auto resized = Clock::now();
+
+        // Encoded straight into a message the publisher takes ownership of, so it isn't copied again.
+        // Reserving the last size keeps the buffer from growing step by step every frame.
+        auto result = std::make_unique<sensor_msgs::msg::CompressedImage>();
+        {
+            tracing::Span span{"image encoded", frame_id};
+            result->header = msg->header;
+            result->format = extension_.substr(1);
+            result->data.reserve(last_size_);
+            cv::imencode(extension_, *image, result->data, encode_params_);
+            last_size_ = result->data.size();
+        }
+        const auto encoded = Clock::now();
+
+        signal_camera_view_->publish(std::move(result));
+        tracing::instant("image published", frame_id);
+        const auto published = Clock::now();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.published;
+        stats_.bytes += last_size_;
+        stats_.wait += start - queued;
+        stats_.resize += resized - start;
+        stats_.encode += encoded - resized;
+        stats_.publish += published - encoded;
+    }
+
+    // Resized frame in BGR, or BGRA if it has alpha, as cv_bridge's toCompressedImageMsg encoded
+    // it before, so an rgb8 camera isn't sent with red and blue swapped. Converted after the
+    // resize, on fewer pixels.
+    const cv::Mat& ToBgr(const sensor_msgs::msg::Image& msg) {
+        namespace encodings = sensor_msgs::image_encodings;
+        const std::string& encoding = msg.encoding;
+        if (encoding == encodings::BGR8 || encoding == encodings::BGRA8) {
+            return resized_;
+        }
+        if (encoding == encodings::RGB8) {
+            cv::cvtColor(resized_, converted_, cv::COLOR_RGB2BGR);
+        } else if (encoding == encodings::RGBA8) {
+            cv::cvtColor(resized_, converted_, cv::COLOR_RGBA2BGRA);
+        } else {
+            const auto target = encodings::hasAlpha(encoding) ? encodings::BGRA8 : encodings::BGR8;
+            auto source = std::make_shared<cv_bridge::CvImage>(msg.header, encoding, resized_);
+            converted_ = cv_bridge::cvtColor(source, target)->image;
+        }
+        return converted_;
+    }
+
+    // Busy is the share of the period the worker spent on frames, the headroom left is the rest.
+    void LogStats(Clock::duration period) {
+        Stats stats;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats = std::exchange(stats_, Stats{});
+        }
+        using milliseconds = std::chrono::duration<double, std::milli>;
+        const double frames = stats.published > 0 ? static_cast<double>(stats.published) : 1.0;
+        const auto busy = stats.resize + stats.encode + stats.publish;
+        RCLCPP_INFO(
+            get_logger(),
+            "frames: received=%lu, skipped=%lu, dropped=%lu, published=%lu, avg_bytes=%.0f; "
+            "avg ms: wait=%.2f, resize=%.2f, encode=%.2f, publish=%.2f; busy=%.0f%%",
+            static_cast<unsigned long>(stats.received), static_cast<unsigned long>(stats.skipped),
+            static_cast<unsigned long>(stats.dropped), static_cast<unsigned long>(stats.published),
+            stats.bytes / frames, milliseconds(stats.wait).count() / frames,
+            milliseconds(stats.resize).count() / frames, milliseconds(stats.encode).count() / frames,
+            milliseconds(stats.publish).count() / frames,
+            100.0 * std::chrono::duration<double>(busy).count() / std::chrono::duration<double>(period).count());
+    }
+
+    int width_ = 0;
+    int height_ = 0;
+    std::string format_;
+    std::string extension_;
+    std::vector<int> encode_params_;
+    Clock::duration min_interval_{};
+    Clock::duration stats_period_{};
+
+    // Guards the waiting frame, the stats and the flag below.
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    sensor_msgs::msg::Image::ConstSharedPtr pending_;
+    Clock::time_point pending_since_;
+    Clock::time_point last_accepted_;
+    Stats stats_;
+    bool stopped_ = false;
+
+    // Worker thread only.
+    cv::Mat resized_;
+    cv::Mat converted_;
+    size_t last_size_ = 0;
+    std::thread worker_;
+
+    rclcpp::Subscription<sensor_msgs::msg::Image>::SharedPtr slot_camera_{};
+    rclcpp::Publisher<sensor_msgs::msg::CompressedImage>::SharedPtr signal_camera_view_{};
+};
+
+}  // namespace camera_view
+
+RCLCPP_COMPONENTS_REGISTER_NODE(camera_view::CameraView)
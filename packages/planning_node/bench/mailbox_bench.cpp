@@ -0,0 +1,109 @@
+#include "src/mailbox.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+
+namespace {
+
+// Mutex and condition variable queue the mailbox replaced, kept as the baseline.
+template <typename T>
+struct LockedSlot {
+    void put(const T& item) {
+        {
+            std::lock_guard<std::mutex> lock{mu};
+            slot = item;
+        }
+        cv.notify_all();
+    }
+
+    std::optional<T> take() {
+        std::unique_lock<std::mutex> lock{mu};
+        cv.wait(lock, [this]() { return slot.has_value() || stopped; });
+        if (stopped) {
+            return {};
+        }
+        std::optional<T> item = std::move(slot);
+        slot.reset();
+        return item;
+    }
+
+    std::optional<T> peek() {
+        std::unique_lock<std::mutex> lock{mu};
+        cv.wait(lock, [this]() { return slot.has_value() || stopped; });
+        if (stopped) {
+            return {};
+        }
+        return slot;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock{mu};
+            stopped = true;
+        }
+        cv.notify_all();
+    }
+
+private:
+    std::mutex mu;
+    std::condition_variable cv;
+    std::optional<T> slot;
+    bool stopped = false;
+};
+
+using Item = std::shared_ptr<int>;
+
+// Put with nobody taking, as when the planner is busy searching.
+template <typename Queue>
+void put_idle(benchmark::State& state) {
+    Queue queue;
+    Item item = std::make_shared<int>(0);
+    for (auto _ : state) {
+        queue.put(item);
+    }
+}
+
+// Put while the consumer takes as fast as it can, sleeping whenever the slot is empty.
+template <typename Queue>
+void put_with_consumer(benchmark::State& state) {
+    Queue queue;
+    std::thread consumer([&queue]() {
+        while (queue.take().has_value()) {
+        }
+    });
+
+    Item item = std::make_shared<int>(0);
+    for (auto _ : state) {
+        queue.put(item);
+    }
+    queue.stop();
+    consumer.join();
+}
+
+// Latest value read, as the planner does for the target every cycle.
+template <typename Queue>
+void peek(benchmark::State& state) {
+    Queue queue;
+    queue.put(std::make_shared<int>(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(queue.peek());
+    }
+}
+
+}
+
+BENCHMARK_TEMPLATE(put_idle, LockedSlot<Item>);
+BENCHMARK_TEMPLATE(put_idle, Mailbox<Item>);
+BENCHMARK_TEMPLATE(put_with_consumer, LockedSlot<Item>)->UseRealTime();
+BENCHMARK_TEMPLATE(put_with_consumer, Mailbox<Item>)->UseRealTime();
+BENCHMARK_TEMPLATE(peek, LockedSlot<Item>);
+BENCHMARK_TEMPLATE(peek, Mailbox<Item>);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,93 @@
+#include "src/planner_core.hpp"
+#include "src/random_scene.hpp"
+
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+using planning_core::GridInfo;
+using planning_core::Planner;
+using planning_core::Pose;
+using planning_core::RandomScene;
+
+const char* const modes[] = {"astar", "incremental", "anytime"};
+
+// Scenes cycled through by every benchmark, so the cache of a single scene does not dominate.
+constexpr uint64_t scene_count = 16;
+
+nlohmann::json bench_config(const char* mode) {
+    std::ifstream config_stream(PLANNER_BENCH_CONFIG);
+    nlohmann::json config = nlohmann::json::parse(config_stream);
+    // Every plan is searched, the cache and revalidation would measure lookups instead.
+    config["mode"] = mode;
+    config["cache"]["capacity"] = 0;
+    config["revalidation"]["enabled"] = false;
+    return config;
+}
+
+// Plans from the origin to a fixed target over seeded scenes.
+// Arguments are the scene radius in meters, the obstacle density in percent and the search mode.
+void plan(benchmark::State& state) {
+    double radius = static_cast<double>(state.range(0));
+    double probability = state.range(1) / 100.0;
+    const char* mode = modes[state.range(2)];
+    state.SetLabel(mode);
+
+    nlohmann::json config = bench_config(mode);
+    double resolution = config["lattice"]["resolution"];
+    Pose target{radius / 2, radius / 2, 0.0};
+
+    std::vector<RandomScene> scenes;
+    for (uint64_t seed = 0; seed < scene_count; ++seed) {
+        std::mt19937_64 engine{seed};
+        scenes.push_back(planning_core::make_random_scene(engine, radius, probability, resolution, target));
+    }
+
+    Planner planner{config};
+    std::vector<double> latencies;
+    size_t expansions = 0;
+    size_t found = 0;
+    uint64_t seed = 0;
+    for (auto _ : state) {
+        const RandomScene& scene = scenes[seed++ % scene_count];
+        auto start = std::chrono::steady_clock::now();
+        planner.set_scene(scene.info, scene.cells.data());
+        planning_core::PlanResult result = planner.plan(Pose{}, target);
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+
+        expansions += result.expansions;
+        found += result.status == planning_core::PlanStatus::Found;
+        benchmark::DoNotOptimize(result.path.data());
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        return latencies[static_cast<size_t>(p * (latencies.size() - 1))];
+    };
+    state.SetItemsProcessed(state.iterations());
+    state.counters["expansions"] = benchmark::Counter(
+        static_cast<double>(expansions), benchmark::Counter::kAvgIterations
+    );
+    state.counters["found"] = benchmark::Counter(static_cast<double>(found), benchmark::Counter::kAvgIterations);
+    state.counters["p50_us"] = percentile(0.5);
+    state.counters["p99_us"] = percentile(0.99);
+}
+
+}
+
+BENCHMARK(plan)
+    ->ArgsProduct({{10, 20, 40}, {5, 15}, {0, 1, 2}})
+    ->ArgNames({"radius", "density", "mode"})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
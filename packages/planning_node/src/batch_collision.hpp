@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+
+// Returns a mask with bit owners[i] set for every check i with distance[offsets[i]] < clearances[i].
+// Offsets are relative to the distance pointer and must stay inside the buffer it points into.
+// Checks are compared eight at a time with AVX2 gathers or four at a time with NEON, the tail
+// and other targets go through the scalar loop.
+inline uint64_t find_collisions(
+    const float* distance, const int32_t* offsets, const float* clearances, const uint8_t* owners, size_t count
+) {
+    uint64_t collisions = 0;
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= count; i += 8) {
+        __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets + i));
+        __m256 gathered = _mm256_i32gather_ps(distance, index, sizeof(float));
+        __m256 less = _mm256_cmp_ps(gathered, _mm256_loadu_ps(clearances + i), _CMP_LT_OQ);
+        for (unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(less)); mask != 0; mask &= mask - 1) {
+            collisions |= uint64_t{1} << owners[i + __builtin_ctz(mask)];
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 4 <= count; i += 4) {
+        const float lanes[4] = {
+            distance[offsets[i]], distance[offsets[i + 1]], distance[offsets[i + 2]], distance[offsets[i + 3]],
+        };
+        uint32x4_t less = vcltq_f32(vld1q_f32(lanes), vld1q_f32(clearances + i));
+        if (vmaxvq_u32(less) == 0) {
+            continue;
+        }
+        uint32_t mask[4];
+        vst1q_u32(mask, less);
+        for (size_t lane = 0; lane < 4; ++lane) {
+            collisions |= static_cast<uint64_t>(mask[lane] & 1) << owners[i + lane];
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        if (distance[offsets[i]] < clearances[i]) {
+            collisions |= uint64_t{1} << owners[i];
+        }
+    }
+    return collisions;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+
+// Non-cryptographic 64-bit hash of a byte range for recognizing repeated content. Reads
+// 32 bytes per step into four independent lanes, so large grids hash at memory speed.
+inline uint64_t content_hash(const void* data, size_t size, uint64_t seed = 0) {
+    auto mix = [](uint64_t hash) {
+        hash *= 0xBF58476D1CE4E5B9;
+        return hash ^ (hash >> 31);
+    };
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t lanes[4] = {
+        seed ^ 0x9E3779B97F4A7C15, seed ^ 0xC2B2AE3D27D4EB4F, seed ^ 0x165667B19E3779F9, seed ^ size,
+    };
+    size_t i = 0;
+    for (; i + sizeof(lanes) <= size; i += sizeof(lanes)) {
+        for (int lane = 0; lane < 4; ++lane) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i + lane * sizeof(word), sizeof(word));
+            lanes[lane] = mix(lanes[lane] ^ word);
+        }
+    }
+    for (; i < size; ++i) {
+        lanes[i % 4] = mix(lanes[i % 4] ^ bytes[i]);
+    }
+
+    uint64_t hash = size;
+    for (uint64_t lane : lanes) {
+        hash = mix(hash ^ mix(lane));
+    }
+    return hash;
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+
+// d-ary min-heap over dense ids in [0, capacity) with O(log n) decrease-key.
+// Positions of queued ids are kept in a flat array, so membership tests are O(1).
+template <typename Priority, size_t Arity = 4>
+struct IndexedHeap {
+    using Id = uint32_t;
+
+    void reset(size_t capacity) {
+        heap.clear();
+        position.assign(capacity, npos);
+    }
+
+    // Allows ids below the capacity, keeping the queued ones.
+    void grow(size_t capacity) {
+        if (capacity > position.size()) {
+            position.resize(capacity, npos);
+        }
+    }
+
+    bool empty() const {
+        return heap.empty();
+    }
+
+    size_t size() const {
+        return heap.size();
+    }
+
+    bool contains(Id id) const {
+        return position[id] != npos;
+    }
+
+    Id top() const {
+        return heap.front().id;
+    }
+
+    const Priority& top_priority() const {
+        return heap.front().priority;
+    }
+
+    // Inserts id or changes its priority if it is already queued.
+    void push(Id id, Priority priority) {
+        if (!contains(id)) {
+            position[id] = static_cast<uint32_t>(heap.size());
+            heap.push_back(Entry{std::move(priority), id});
+            sift_up(heap.size() - 1);
+            return;
+        }
+
+        size_t pos = position[id];
+        bool decreased = priority < heap[pos].priority;
+        heap[pos].priority = std::move(priority);
+        if (decreased) {
+            sift_up(pos);
+        } else {
+            sift_down(pos);
+        }
+    }
+
+    void pop() {
+        erase(top());
+    }
+
+    // Recomputes the priority of every queued id and restores the heap in O(n).
+    template <typename PriorityFunction>
+    void reprioritize(PriorityFunction priority) {
+        for (Entry& entry : heap) {
+            entry.priority = priority(entry.id);
+        }
+        for (size_t pos = heap.size() / Arity + 1; pos-- > 0;) {
+            if (pos < heap.size()) {
+                sift_down(pos);
+            }
+        }
+    }
+
+    void erase(Id id) {
+        size_t pos = position[id];
+        position[id] = npos;
+        if (pos + 1 == heap.size()) {
+            heap.pop_back();
+            return;
+        }
+
+        heap[pos] = std::move(heap.back());
+        heap.pop_back();
+        position[heap[pos].id] = static_cast<uint32_t>(pos);
+        sift_up(pos);
+        sift_down(position[heap[pos].id]);
+    }
+
+private:
+    static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+    struct Entry {
+        Priority priority;
+        Id id;
+    };
+
+    void sift_up(size_t pos) {
+        Entry entry = std::move(heap[pos]);
+        while (pos > 0) {
+            size_t parent = (pos - 1) / Arity;
+            if (!(entry.priority < heap[parent].priority)) {
+                break;
+            }
+            place(pos, std::move(heap[parent]));
+            pos = parent;
+        }
+        place(pos, std::move(entry));
+    }
+
+    void sift_down(size_t pos) {
+        Entry entry = std::move(heap[pos]);
+        while (true) {
+            size_t first = pos * Arity + 1;
+            if (first >= heap.size()) {
+                break;
+            }
+
+            size_t last = std::min(first + Arity, heap.size());
+            size_t best = first;
+            for (size_t child = first + 1; child < last; ++child) {
+                if (heap[child].priority < heap[best].priority) {
+                    best = child;
+                }
+            }
+            if (!(heap[best].priority < entry.priority)) {
+                break;
+            }
+            place(pos, std::move(heap[best]));
+            pos = best;
+        }
+        place(pos, std::move(entry));
+    }
+
+    void place(size_t pos, Entry entry) {
+        position[entry.id] = static_cast<uint32_t>(pos);
+        heap[pos] = std::move(entry);
+    }
+
+    std::vector<Entry> heap;
+    std::vector<uint32_t> position;
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+
+// Map of bounded size dropping the least recently used entry when full. Evicted nodes are
+// reused for new entries, so a full cache of vectors keeps their capacity.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+struct LruCache {
+    explicit LruCache(size_t capacity = 0) : capacity{capacity} {
+    }
+
+    // Returns nullptr on a miss, a hit becomes the most recently used entry.
+    const Value* find(const Key& key) {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            return nullptr;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->second;
+    }
+
+    void insert(const Key& key, const Value& value) {
+        if (capacity == 0) {
+            return;
+        }
+
+        auto it = index.find(key);
+        if (it != index.end()) {
+            entries.splice(entries.begin(), entries, it->second);
+            it->second->second = value;
+            return;
+        }
+
+        if (entries.size() < capacity) {
+            entries.emplace_front(key, value);
+        } else {
+            entries.splice(entries.begin(), entries, std::prev(entries.end()));
+            index.erase(entries.front().first);
+            entries.front().first = key;
+            entries.front().second = value;
+        }
+        index.emplace(key, entries.begin());
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+private:
+    size_t capacity;
+    std::list<std::pair<Key, Value>> entries;
+    std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator, Hash> index;
+};
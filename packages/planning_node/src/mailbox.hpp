@@ -0,0 +1,124 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+
+// Latest-value mailbox between one producer and one consumer thread. A triple buffer lets
+// put, take and peek complete without waiting on each other: the producer fills its own slot
+// and swaps it with the shared middle one, the consumer swaps the middle one with its own slot.
+// A value not taken before the next put is dropped. The mutex is only used to sleep in take
+// and to wake a sleeping consumer, so a put never blocks on a busy consumer.
+template <typename T>
+struct Mailbox {
+    // Never blocks, overwrites the value not taken yet.
+    void put(T item) {
+        slots[back].value = std::move(item);
+        uint8_t previous = middle.exchange(back | fresh, std::memory_order_seq_cst);
+        back = previous & index_mask;
+        if (previous & fresh) {
+            dropped_items.store(dropped_items.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        // Counted after the value is visible, so a consumer that saw the version sees the value.
+        puts.store(puts.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+        if (sleeping.load(std::memory_order_seq_cst)) {
+            // Consumer is either before its check or waiting once the lock is free.
+            std::unique_lock<std::mutex> lock{mu};
+            lock.unlock();
+            cv.notify_one();
+        }
+    }
+
+    // Waits for a value newer than the last one taken or peeked, returns nothing once stopped.
+    std::optional<T> take() {
+        if (!receive()) {
+            std::unique_lock<std::mutex> lock{mu};
+            sleeping.store(true, std::memory_order_seq_cst);
+            // Pairs with put: either it sees the consumer sleeping or the consumer sees the value.
+            cv.wait(lock, [this]() {
+                return stopped.load(std::memory_order_acquire) || (middle.load(std::memory_order_seq_cst) & fresh);
+            });
+            sleeping.store(false, std::memory_order_relaxed);
+        }
+        if (stopped.load(std::memory_order_acquire)) {
+            return {};
+        }
+        receive();
+        std::optional<T> item = std::move(slots[front].value);
+        slots[front].value = T{};
+        has_front = false;
+        return item;
+    }
+
+    // Latest value that was put and not taken, never blocks.
+    std::optional<T> peek() {
+        receive();
+        if (!has_front) {
+            return {};
+        }
+        return slots[front].value;
+    }
+
+    // Whether a new value is waiting, cheap enough to poll from a busy loop.
+    bool pending() const {
+        return middle.load(std::memory_order_acquire) & fresh;
+    }
+
+    // Number of values put so far, cheap enough to poll from a busy loop.
+    uint64_t version() const {
+        return puts.load(std::memory_order_acquire);
+    }
+
+    // Number of values overwritten before the consumer got them.
+    uint64_t dropped() const {
+        return dropped_items.load(std::memory_order_relaxed);
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock{mu};
+            stopped.store(true, std::memory_order_release);
+        }
+        cv.notify_all();
+    }
+
+private:
+    static constexpr uint8_t index_mask = 0x3;
+    static constexpr uint8_t fresh = 0x4;
+
+    // Moves the middle slot to the consumer if it holds a new value.
+    bool receive() {
+        if (!pending()) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & index_mask;
+        has_front = true;
+        return true;
+    }
+
+    // Slots sit on their own cache lines, so producer and consumer don't share them.
+    struct alignas(64) Slot {
+        T value{};
+    };
+
+    Slot slots[3];
+    alignas(64) std::atomic<uint8_t> middle{1};
+    std::atomic<uint64_t> puts{0};
+    std::atomic<uint64_t> dropped_items{0};
+
+    // Owned by the producer.
+    alignas(64) uint8_t back = 0;
+
+    // Owned by the consumer.
+    alignas(64) uint8_t front = 2;
+    bool has_front = false;
+    std::atomic<bool> sleeping{false};
+    std::atomic<bool> stopped{false};
+
+    std::mutex mu;
+    std::condition_variable cv;
+};
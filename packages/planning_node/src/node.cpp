@@ -1,14 +1,21 @@
 #include "node.hpp"
 
+#include "mailbox.hpp"
 #include "planner.hpp"
+#include "planning_interfaces/msg/meta_data.hpp"
 #include "planning_interfaces/msg/path.hpp"
 #include "planning_interfaces/msg/point.hpp"
 #include "planning_interfaces/msg/scene.hpp"
+#include "planning_interfaces/msg/scene_delta.hpp"
 #include "rclcpp/rclcpp.hpp"
-#include "single_slot_queue.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
+#include "scene_delta.hpp"
+#include "tracing/trace.hpp"
 
+#include <chrono>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 
 
 namespace planning_node {
@@ -19,55 +26,133 @@ using std::placeholders::_1;
 
 
 struct PlanningNode : public rclcpp::Node {
-    PlanningNode(std::string config_path) : Node("PlanningNode") {
+    explicit PlanningNode(const rclcpp::NodeOptions& options) : Node("PlanningNode", options) {
+        tracing::start_from_env();
+        std::string config_path = declare_parameter<std::string>(
+            "config_path", "packages/planning_node/config.json"
+        );
+        // Empty path leaves recording off, see scenario_log.hpp.
+        std::string scenario_log_path = declare_parameter<std::string>("scenario_log", "");
+        // Zero leaves plan metadata off, so the planner doesn't collect search stats either.
+        double metadata_rate_hz = declare_parameter<double>("metadata_rate_hz", 0.0);
+        // Every delta puts the whole chain since the keyframe, so past this many the node waits
+        // for the next keyframe rather than letting the chain grow if keyframes are rare or stop.
+        max_scene_deltas = declare_parameter<int>("max_scene_deltas", 100);
+        if (max_scene_deltas < 1) {
+            throw std::invalid_argument("max_scene_deltas must be positive");
+        }
+
+        // Const messages let in-process publishers share the scene instead of copying it.
         scene_subscription = create_subscription<msg::Scene>(
             "scene", 10, std::bind(&PlanningNode::new_scene_callback, this, _1)
         );
+        scene_delta_subscription = create_subscription<msg::SceneDelta>(
+            "scene_delta", 10, std::bind(&PlanningNode::new_scene_delta_callback, this, _1)
+        );
         target_subscription = create_subscription<msg::Point>(
             "target", 10, std::bind(&PlanningNode::new_target_callback, this, _1)
         );
 
-        scene_queue = std::make_shared<SingleSlotQueue<msg::Scene::SharedPtr>>();
-        target_queue = std::make_shared<SingleSlotQueue<msg::Point::SharedPtr>>();
+        scene_queue = std::make_shared<Mailbox<SceneUpdate>>();
+        target_queue = std::make_shared<Mailbox<msg::Point::ConstSharedPtr>>();
 
         path_publisher = create_publisher<msg::Path>("path", 10);
+        if (metadata_rate_hz > 0.0) {
+            metadata_publisher = create_publisher<msg::MetaData>("metadata", 10);
+        }
+
+        planner_thread = start_planner(
+            scene_queue, target_queue, path_publisher, metadata_publisher, metadata_rate_hz, config_path,
+            scenario_log_path, get_logger()
+        );
+    }
 
-        planner_thread = start_planner(scene_queue, target_queue, path_publisher, config_path, get_logger());
+    // Container unloads the component without a shutdown callback, so the planner is joined here.
+    ~PlanningNode() {
+        stop();
     }
 
     void stop() {
         scene_queue->stop();
         target_queue->stop();
-        planner_thread.join();
+        if (planner_thread.joinable()) {
+            planner_thread.join();
+        }
     }
 
 private:
-    void new_scene_callback(const msg::Scene::SharedPtr message) const {
-        RCLCPP_INFO(get_logger(), "New scene: created_at=%ld", message->created_at);
-        scene_queue->put(message);
+    void new_scene_callback(msg::Scene::ConstSharedPtr message) {
+        RCLCPP_INFO(get_logger(), "New scene: created_at=%ld, id=%lu", message->created_at, message->id);
+        tracing::instant("scene received", message->id);
+        scene_update.keyframe = message;
+        scene_update.deltas.clear();
+        scene_update.received = std::chrono::steady_clock::now();
+        scene_queue->put(scene_update);
+    }
+
+    // Deltas are chained onto the last keyframe, a delta not based on the end of the chain or
+    // past max_scene_deltas is dropped along with the ones after it until the next keyframe.
+    void new_scene_delta_callback(msg::SceneDelta::ConstSharedPtr message) {
+        RCLCPP_DEBUG(
+            get_logger(), "New scene delta: created_at=%ld, base_id=%lu, id=%lu",
+            message->created_at, message->base_id, message->id
+        );
+        tracing::instant("scene delta received", message->id);
+        if (!scene_update.keyframe) {
+            return;
+        }
+        uint64_t last_id = scene_update.deltas.empty() ? scene_update.keyframe->id : scene_update.deltas.back()->id;
+        const nav_msgs::msg::OccupancyGrid& grid = scene_update.keyframe->occupancy_grid;
+        if (last_id == 0 || message->base_id != last_id || message->id == 0 ||
+            !delta_fits(*message, grid.data.size())) {
+            RCLCPP_INFO(
+                get_logger(), "Scene delta %lu doesn't apply to scene %lu, waiting for a keyframe",
+                message->id, last_id
+            );
+            scene_update.keyframe.reset();
+            scene_update.deltas.clear();
+            return;
+        }
+        if (scene_update.deltas.size() >= static_cast<size_t>(max_scene_deltas)) {
+            RCLCPP_INFO(
+                get_logger(), "Scene %lu has %d deltas on top already, waiting for a keyframe",
+                scene_update.keyframe->id, max_scene_deltas
+            );
+            scene_update.keyframe.reset();
+            scene_update.deltas.clear();
+            return;
+        }
+        scene_update.deltas.push_back(message);
+        scene_update.received = std::chrono::steady_clock::now();
+        scene_queue->put(scene_update);
     }
 
-    void new_target_callback(const msg::Point::SharedPtr message) const {
+    void new_target_callback(msg::Point::ConstSharedPtr message) const {
         RCLCPP_INFO(get_logger(), "New target: x=%.3f, y=%.3f, theta=%.3f", message->x, message->y, message->theta);
+        tracing::instant("target received");
         target_queue->put(message);
     }
 
     rclcpp::Subscription<msg::Scene>::SharedPtr scene_subscription;
+    rclcpp::Subscription<msg::SceneDelta>::SharedPtr scene_delta_subscription;
     rclcpp::Subscription<msg::Point>::SharedPtr target_subscription;
-    std::shared_ptr<SingleSlotQueue<msg::Scene::SharedPtr>> scene_queue;
-    std::shared_ptr<SingleSlotQueue<msg::Point::SharedPtr>> target_queue;
+    std::shared_ptr<Mailbox<SceneUpdate>> scene_queue;
+    SceneUpdate scene_update;
+    int max_scene_deltas;
+    std::shared_ptr<Mailbox<msg::Point::ConstSharedPtr>> target_queue;
     rclcpp::Publisher<msg::Path>::SharedPtr path_publisher;
+    rclcpp::Publisher<msg::MetaData>::SharedPtr metadata_publisher;
 
     std::thread planner_thread;
 };
 
 std::thread start_planning_node(int argc, char** argv) {
     auto start_node = [](int argc, char** argv) {
-        std::string config_path;
+        rclcpp::NodeOptions options;
         if (argc > 1) {
-            config_path = argv[1];
-            if (config_path.empty()) {
-                config_path = "packages/planning_node/config.json";
+            std::string config_path = argv[1];
+            if (!config_path.empty()) {
+                options.parameter_overrides({{"config_path", config_path}});
             }
 
             --argc;
@@ -77,7 +162,7 @@ std::thread start_planning_node(int argc, char** argv) {
         std::cout << "Starting planning node" << std::endl;
 
         rclcpp::init(argc, argv);
-        std::shared_ptr<PlanningNode> node = std::make_shared<PlanningNode>(config_path);
+        std::shared_ptr<PlanningNode> node = std::make_shared<PlanningNode>(options);
         rclcpp::on_shutdown([node]() {
             node->stop();
         });
@@ -88,3 +173,5 @@ std::thread start_planning_node(int argc, char** argv) {
 }
 
 }
+
+RCLCPP_COMPONENTS_REGISTER_NODE(planning_node::PlanningNode)
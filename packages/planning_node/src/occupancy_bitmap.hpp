@@ -0,0 +1,215 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Occupancy grid packed to one bit per cell, set for occupied cells. Rows start on cache line
+// boundaries, so a row of a 512 cells wide grid takes a single line instead of eight.
+struct OccupancyBitmap {
+    static constexpr size_t line_bytes = 64;
+    static constexpr size_t line_words = line_bytes / sizeof(uint64_t);
+
+    // How a coarser bitmap combines the 2x2 cells each of its cells covers.
+    enum class Pooling {
+        Any,
+        All,
+    };
+
+    // Cells with positive occupancy are occupied, unknown (negative) cells are free.
+    void build(const int8_t* data, int new_width, int new_height) {
+        allocate(new_width, new_height);
+        for (int y = 0; y < height; ++y) {
+            const int8_t* cells = data + static_cast<size_t>(y) * width;
+            uint64_t* row = words(y);
+            for (int x = 0; x < width; ++x) {
+                row[x >> 6] |= static_cast<uint64_t>(cells[x] > 0) << (x & 63);
+            }
+        }
+    }
+
+    // Rewrites the cells of the inclusive rectangle from the grid the bitmap was built from.
+    void update(const int8_t* data, int x0, int y0, int x1, int y1) {
+        for (int y = y0; y <= y1; ++y) {
+            const int8_t* cells = data + static_cast<size_t>(y) * width;
+            uint64_t* row = words(y);
+            for (int x = x0; x <= x1; ++x) {
+                uint64_t bit = uint64_t{1} << (x & 63);
+                row[x >> 6] = cells[x] > 0 ? row[x >> 6] | bit : row[x >> 6] & ~bit;
+            }
+        }
+    }
+
+    // Builds the bitmap at half the resolution of the finer one. Cells beyond the finer grid
+    // are left out, so an All cell on the border is occupied if its cells inside the grid are.
+    void pool(const OccupancyBitmap& finer, Pooling pooling) {
+        allocate((finer.width + 1) / 2, (finer.height + 1) / 2);
+        pool_words(finer, pooling, 0, 0, row_words() - 1, height - 1);
+    }
+
+    // Pools the cells of the inclusive rectangle again after the finer bitmap changed under it.
+    void pool(const OccupancyBitmap& finer, Pooling pooling, int x0, int y0, int x1, int y1) {
+        pool_words(finer, pooling, static_cast<size_t>(x0) >> 6, y0, static_cast<size_t>(x1) >> 6, y1);
+    }
+
+    // Cell must lie inside the grid.
+    bool test(int x, int y) const {
+        return (words(y)[x >> 6] >> (x & 63)) & 1;
+    }
+
+    int width = 0;
+    int height = 0;
+
+private:
+    // Pools words i0..i1 of rows y0..y1.
+    void pool_words(const OccupancyBitmap& finer, Pooling pooling, size_t i0, int y0, size_t i1, int y1) {
+        uint64_t fill = pooling == Pooling::All ? ~uint64_t{0} : 0;
+        auto finer_word = [&](int y, size_t i) {
+            if (y >= finer.height || i >= finer.row_words()) {
+                return fill;
+            }
+            uint64_t word = finer.words(y)[i];
+            size_t valid = static_cast<size_t>(finer.width) - 64 * i;
+            return valid < 64 ? word | (fill << valid) : word;
+        };
+        auto combine = [pooling](uint64_t a, uint64_t b) {
+            return pooling == Pooling::All ? a & b : a | b;
+        };
+
+        size_t valid = static_cast<size_t>(width) - 64 * (row_words() - 1);
+        for (int y = y0; y <= y1; ++y) {
+            uint64_t* row = words(y);
+            for (size_t i = i0; i <= i1; ++i) {
+                uint64_t low = combine(finer_word(2 * y, 2 * i), finer_word(2 * y + 1, 2 * i));
+                uint64_t high = combine(finer_word(2 * y, 2 * i + 1), finer_word(2 * y + 1, 2 * i + 1));
+                row[i] = even_bits(combine(low, low >> 1)) | even_bits(combine(high, high >> 1)) << 32;
+            }
+            if (i1 == row_words() - 1 && valid < 64) {
+                row[i1] &= ~(~uint64_t{0} << valid);
+            }
+        }
+    }
+
+    void allocate(int new_width, int new_height) {
+        width = new_width;
+        height = new_height;
+        stride = (row_words() + line_words - 1) / line_words * line_words;
+
+        // Extra line lets the first row start on a line boundary whatever the allocation alignment.
+        storage.assign(stride * height + line_words, 0);
+        size_t misalignment = reinterpret_cast<uintptr_t>(storage.data()) % line_bytes / sizeof(uint64_t);
+        first = misalignment == 0 ? 0 : line_words - misalignment;
+    }
+
+    size_t row_words() const {
+        return (static_cast<size_t>(width) + 63) / 64;
+    }
+
+    uint64_t* words(int y) {
+        return storage.data() + first + static_cast<size_t>(y) * stride;
+    }
+
+    const uint64_t* words(int y) const {
+        return storage.data() + first + static_cast<size_t>(y) * stride;
+    }
+
+    // Moves bit 2k of the word to bit k, odd bits are dropped.
+    static uint64_t even_bits(uint64_t word) {
+        word &= 0x5555555555555555;
+        word = (word | word >> 1) & 0x3333333333333333;
+        word = (word | word >> 2) & 0x0F0F0F0F0F0F0F0F;
+        word = (word | word >> 4) & 0x00FF00FF00FF00FF;
+        word = (word | word >> 8) & 0x0000FFFF0000FFFF;
+        return (word | word >> 16) & 0x00000000FFFFFFFF;
+    }
+
+    size_t stride = 0;
+    size_t first = 0;
+    std::vector<uint64_t> storage;
+};
+
+// Occupancy at halving resolutions, a cell of level k covers 2^k x 2^k grid cells. Any levels
+// mark cells holding some obstacle and all levels cells holding nothing else, so a clear any
+// cell is certainly free and a set all cell certainly blocked. Level 0 is the grid itself.
+struct OccupancyPyramid {
+    void build(const int8_t* data, int width, int height) {
+        level_count = 1;
+        for (int w = width, h = height; w > 1 || h > 1; w = (w + 1) / 2, h = (h + 1) / 2) {
+            ++level_count;
+        }
+        // Levels are only added, so their storage is reused by later scenes.
+        if (any_levels.size() < static_cast<size_t>(level_count)) {
+            any_levels.resize(level_count);
+            all_levels.resize(level_count - 1);
+        }
+
+        any_levels[0].build(data, width, height);
+        for (int level = 1; level < level_count; ++level) {
+            any_levels[level].pool(any_levels[level - 1], OccupancyBitmap::Pooling::Any);
+            all_levels[level - 1].pool(all(level - 1), OccupancyBitmap::Pooling::All);
+        }
+    }
+
+    // Brings the levels up to the grid after the cells of the inclusive rectangle changed. The
+    // grid must keep the size the pyramid was built for.
+    void update(const int8_t* data, int x0, int y0, int x1, int y1) {
+        any_levels[0].update(data, x0, y0, x1, y1);
+        for (int level = 1; level < level_count; ++level) {
+            x0 >>= 1;
+            y0 >>= 1;
+            x1 >>= 1;
+            y1 >>= 1;
+            any_levels[level].pool(any_levels[level - 1], OccupancyBitmap::Pooling::Any, x0, y0, x1, y1);
+            all_levels[level - 1].pool(all(level - 1), OccupancyBitmap::Pooling::All, x0, y0, x1, y1);
+        }
+    }
+
+    const OccupancyBitmap& grid() const {
+        return any_levels[0];
+    }
+
+    int levels() const {
+        return level_count;
+    }
+
+    const OccupancyBitmap& any(int level) const {
+        return any_levels[level];
+    }
+
+    const OccupancyBitmap& all(int level) const {
+        return level == 0 ? grid() : all_levels[level - 1];
+    }
+
+    // Whether the grid cells of the inclusive rectangle are all free, cells outside the grid count
+    // as free. Looks at a few cells of a level coarse enough, so may miss free rectangles next to
+    // obstacles but never reports an occupied one as free.
+    bool free(int x0, int y0, int x1, int y1) const {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, grid().width - 1);
+        y1 = std::min(y1, grid().height - 1);
+        if (x0 > x1 || y0 > y1) {
+            return true;
+        }
+
+        int level = 0;
+        int side = std::min(x1 - x0, y1 - y0) + 1;
+        while (level + 1 < levels() && (2 << level) <= side / 2) {
+            ++level;
+        }
+        for (int y = y0 >> level; y <= y1 >> level; ++y) {
+            for (int x = x0 >> level; x <= x1 >> level; ++x) {
+                if (any(level).test(x, y)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    int level_count = 0;
+    std::vector<OccupancyBitmap> any_levels;
+    std::vector<OccupancyBitmap> all_levels;
+};
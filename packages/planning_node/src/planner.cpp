@@ -1,379 +1,332 @@
 #include "planner.hpp"
 
-#include "float_comparison.hpp"
 #include "geometry_msgs/msg/pose_stamped.hpp"
-#include "geometry_msgs/msg/pose.hpp"
 #include "nlohmann/json.hpp"
+#include "planner_core.hpp"
+#include "scenario_log.hpp"
+#include "scene_delta.hpp"
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
+#include "tracing/trace.hpp"
 #include "tf2/LinearMath/Quaternion.h"
 
 #include <algorithm>
 #include <chrono>
-#include <cmath>
 #include <fstream>
 #include <memory>
-#include <set>
-#include <unordered_map>
-#include <unordered_set>
+#include <optional>
+#include <string>
+#include <utility>
 #include <vector>
 
 
-using namespace planning_interfaces;
+namespace planning_node {
+
+using nlohmann::json;
+using planning_core::PlanResult;
+using planning_core::PlanStatus;
+using planning_core::Pose;
 
 namespace {
 
-using nlohmann::json;
+geometry_msgs::msg::PoseStamped to_pose_stamped(Pose pose) {
+    geometry_msgs::msg::PoseStamped res;
+    res.pose.position.x = pose.x;
+    res.pose.position.y = pose.y;
 
-inline void hash_combine(std::size_t&) {}
+    tf2::Quaternion quart;
+    quart.setRPY(0.0, 0.0, pose.theta);
+    res.pose.orientation = tf2::toMsg(quart);
 
-template <typename T, typename... Rest>
-inline void hash_combine(std::size_t& seed, const T& v, Rest... rest) {
-    std::hash<T> hasher;
-    seed ^= hasher(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-    hash_combine(seed, rest...);
+    return res;
 }
 
-double mod_interval(double x, double modulo) {
-    return std::fmod(std::fmod(x, modulo) + modulo, modulo);
+planning_core::GridInfo grid_info(const nav_msgs::msg::OccupancyGrid& grid) {
+    return planning_core::GridInfo{
+        static_cast<int>(grid.info.width),
+        static_cast<int>(grid.info.height),
+        grid.info.resolution,
+        grid.info.origin.position.x,
+        grid.info.origin.position.y,
+    };
 }
 
-struct ComparisonTolerances {
-    static std::unique_ptr<ComparisonTolerances> instance;
-
-    static double get_x() {
-        return instance->x;
-    }
-    static double get_y() {
-        return instance->y;
-    }
-    static double get_theta() {
-        return instance->theta;
-    }
-    static double get_distance() {
-        return instance->distance;
-    }
-
-    static void load_from_json(const json& tolerances) {
-        instance = std::make_unique<ComparisonTolerances>();
-        for (auto it = tolerances.begin(); it != tolerances.end(); ++it) {
-            if (it.key() == "x") {
-                instance->x = it.value();
-            } else if (it.key() == "y") {
-                instance->y = it.value();
-            } else if (it.key() == "theta") {
-                instance->theta = it.value();
-            } else if (it.key() == "distance") {
-                instance->distance = it.value();
-            }
-        }
-    }
-
-    static void load_default() {
-        instance = std::make_unique<ComparisonTolerances>();
-        instance->x = 0.00001;
-        instance->y = 0.00001;
-        instance->theta = 0.01;
-        instance->distance = 0.00001;
+const char* status_name(PlanStatus status) {
+    switch (status) {
+    case PlanStatus::Found:
+        return "found";
+    case PlanStatus::NotFound:
+        return "not_found";
+    case PlanStatus::Preempted:
+        return "preempted";
+    case PlanStatus::TooManyStates:
+        return "too_many_states";
+    case PlanStatus::OutsideScene:
+        return "outside_scene";
+    case PlanStatus::OutOfMemory:
+        return "out_of_memory";
     }
-
-private:
-    double x;
-    double y;
-    double theta;
-    double distance;
-};
-
-std::unique_ptr<ComparisonTolerances> ComparisonTolerances::instance = nullptr;
-
-struct State {
-    double x;
-    double y;
-    double theta;
-
-    double distance;
-
-    static State from_json(const json& state) {
-        return State{
-            state["x"],
-            state["y"],
-            mod_interval(state["theta"], 2 * M_PI),
-            0.0,
-        };
-    }
-
-    static State from_point(msg::Point::SharedPtr point) {
-        return State{
-            point->x,
-            point->y,
-            mod_interval(point->theta, 2 * M_PI),
-            0.0,
-        };
-    }
-
-    json to_json() const {
-        json state;
-        state["x"] = x;
-        state["y"] = y;
-        state["theta"] = theta;
-        return state;
-    }
-
-    geometry_msgs::msg::PoseStamped to_pose_stamped() const {
-        geometry_msgs::msg::PoseStamped res;
-        res.pose.position.x = x;
-        res.pose.position.y = y;
-
-        tf2::Quaternion quart;
-        quart.setRPY(0.0, 0.0, theta);
-        res.pose.orientation = tf2::toMsg(quart);
-
-        return res;
-    }
-
-    bool operator==(State o) const {
-        return very_close_equals(x, o.x, ComparisonTolerances::get_x()) &&
-            very_close_equals(y, o.y, ComparisonTolerances::get_y()) &&
-            very_close_equals(theta, o.theta, ComparisonTolerances::get_theta());
-    }
-    bool operator!=(State o) const {
-        return !(*this == o);
-    }
-};
-
+    return "unknown";
 }
 
-template <>
-struct std::hash<State> {
-    std::size_t operator()(const State& s) const {
-        size_t res = 0;
-        hash_combine(
-            res,
-            static_cast<int64_t>(s.x * 1000),  // FIXME: use better hash for floating point values
-            static_cast<int64_t>(s.y * 1000),
-            static_cast<int64_t>(s.theta * 360)
-        );
-        return res;
-    }
-};
-
-namespace {
-
-struct StateComparator {
-    bool operator()(State a, State b) const {
-        // todo: review this (is this a valid comparator?)
-        if (a == b) {
-            return false;
-        }
-
-        // todo: this looks ugly, maybe rewrite it with macros
-        if (very_close_less(a.distance, b.distance, ComparisonTolerances::get_distance())) {
-            return true;
-        } else if (very_close_equals(a.distance, b.distance, ComparisonTolerances::get_distance())) {
-            if (very_close_less(a.x, b.x, ComparisonTolerances::get_x())) {
-                return true;
-            } else if (very_close_equals(a.x, b.x, ComparisonTolerances::get_x())) {
-                if (very_close_less(a.y, b.y, ComparisonTolerances::get_y())) {
-                    return true;
-                } else if (very_close_equals(a.y, b.y, ComparisonTolerances::get_y())) {
-                    return very_close_less(a.theta, b.theta, ComparisonTolerances::get_theta());
-                }
-            }
-        }
-        return false;
-    }
-};
-
-struct MotionPrimitive {
-    double dx;
-    double dy;
-    double dtheta;
-
-    double weight;
-
-    static MotionPrimitive from_json(const json& primitive) {
-        return MotionPrimitive{
-            primitive["dx"],
-            primitive["dy"],
-            mod_interval(primitive["dtheta"], 2 * M_PI),
-            primitive["weight"],
-        };
-    }
-
-    State apply(State state) const {
-        return State{
-            state.x + std::cos(state.theta) * dx - std::sin(state.theta) * dy,
-            state.y + std::sin(state.theta) * dx + std::cos(state.theta) * dy,
-            mod_interval(state.theta + dtheta, 2 * M_PI),
-            state.distance + weight,
-        };
-    }
-};
-
-using MotionPrimitives = std::vector<MotionPrimitive>;
-
-struct CollisionTester {
-    CollisionTester(msg::Scene::SharedPtr scene) : scene(scene) {
-    }
-
-    bool test(State state) {
-        if (std::abs(state.x) > 20 || std::abs(state.y) > 20) {
-            return true;
-        }
-
-        int grid_x = static_cast<int>(state.x - scene->occupancy_grid.info.origin.position.x - 0.5);
-        int grid_y = static_cast<int>(state.y - scene->occupancy_grid.info.origin.position.y - 0.5);
-        return scene->occupancy_grid.data[grid_y * scene->occupancy_grid.info.width + grid_x] > 0;
-    }
-
-private:
-    msg::Scene::SharedPtr scene;
-};
-
-struct StateSpace {
-    StateSpace(CollisionTester tester, MotionPrimitives primitives)
-        : tester{tester}
-        , primitives{primitives}
-        , open_set{StateComparator{}} {
-    }
-
-    State get_optimal() {
-        return *open_set.begin();
-    }
-
-    void expand_optimal() {
-        State optimal = get_optimal();
-        open_set.erase(open_set.begin());
-        open_set_checker.erase(optimal);
-        closed_set.insert(optimal);
-
-        for (MotionPrimitive primitive : primitives) {
-            State next_state = primitive.apply(optimal);
-            if (closed_set.find(next_state) != closed_set.end() ||
-                open_set_checker.find(next_state) != closed_set.end() ||
-                tester.test(next_state)) {
-                continue;
-            }
-            open_set.insert(next_state);
-            open_set_checker.insert(next_state);
-            origin[next_state] = optimal;
-        }
-    }
-
-    bool empty() const {
-        return open_set.empty();
-    }
-
-    void insert(State state) {
-        open_set.insert(state);
-        open_set_checker.insert(state);
-    }
-
-    CollisionTester tester;
-    MotionPrimitives primitives;
-    std::set<State, StateComparator> open_set;
-    std::unordered_set<State> open_set_checker;
-    std::unordered_set<State> closed_set;
-
-    std::unordered_map<State, State> origin;
-};
-
+json read_config(const std::string& config_path) {
+    std::ifstream config_stream(config_path);
+    return json::parse(config_stream);
 }
 
-namespace planning_node {
+}
 
+// Feeds scenes and targets from the topics to the planner core and publishes its paths.
 struct Planner {
     Planner(
-        std::shared_ptr<SingleSlotQueue<msg::Scene::SharedPtr>> scene_queue,
-        std::shared_ptr<SingleSlotQueue<msg::Point::SharedPtr>> target_queue,
+        std::shared_ptr<Mailbox<SceneUpdate>> scene_queue,
+        std::shared_ptr<Mailbox<msg::Point::ConstSharedPtr>> target_queue,
         rclcpp::Publisher<msg::Path>::SharedPtr path_publisher,
-        std::string config_path,
+        rclcpp::Publisher<msg::MetaData>::SharedPtr metadata_publisher,
+        double metadata_rate_hz,
+        json config,
+        const std::string& scenario_log_path,
         rclcpp::Logger logger
     ) : scene_queue(scene_queue)
       , target_queue(target_queue)
       , path_publisher(path_publisher)
-      , logger(logger) {
-        std::ifstream config_stream(config_path);
-        json config = json::parse(config_stream);
+      , metadata_publisher(metadata_publisher)
+      , logger(logger)
+      , core(config)
+      , initial{config["initial"]["x"], config["initial"]["y"], config["initial"]["theta"]}
+      , memory_limit_mb(config["lattice"]["memory_limit_mb"]) {
+        if (!scenario_log_path.empty()) {
+            RCLCPP_INFO(logger, "Recording scenarios to %s", scenario_log_path.c_str());
+            recorder = std::make_unique<planning_core::ScenarioWriter>(scenario_log_path);
+        }
+        if (metadata_publisher) {
+            metadata_period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(1.0 / metadata_rate_hz)
+            );
+            core.collect_stats(true);
+        }
+    }
 
-        ComparisonTolerances::load_from_json(config["tolerances"]);
-        for (auto json_primitive : config["primitives"]) {
-            primitives.push_back(MotionPrimitive::from_json(json_primitive));
+    // Brings the core scene up to the update. Deltas on top of the keyframe already in the core
+    // are written into its cells in place, any other update replaces the scene.
+    void receive_scene(const SceneUpdate& update) {
+        scene_id = update.deltas.empty() ? update.keyframe->id : update.deltas.back()->id;
+        tracing::Span span{"scene update", scene_id};
+        if (update.keyframe != scene_keyframe || applied_deltas > update.deltas.size()) {
+            const nav_msgs::msg::OccupancyGrid& grid = update.keyframe->occupancy_grid;
+            if (core.set_scene(grid_info(grid), grid.data.data())) {
+                RCLCPP_INFO(logger, "Scene resolution changed to %.3f, rebuilding primitives", grid.info.resolution);
+            }
+            scene_keyframe = update.keyframe;
+            applied_deltas = 0;
         }
 
-        initial = State::from_json(config["initial"]);
+        planning_core::GridRegion changed;
+        for (; applied_deltas < update.deltas.size(); ++applied_deltas) {
+            changed.add(apply_delta(*update.deltas[applied_deltas], core.cells(), core.scene().width));
+        }
+        core.changed(changed);
     }
 
-    nav_msgs::msg::Path plan(CollisionTester tester, MotionPrimitives primitives, State initial, State target) {
-        StateSpace state_space(tester, primitives);
-        state_space.insert(initial);
-
-        bool found = false;
-        while (!state_space.empty()) {
-            State optimal = state_space.get_optimal();
-            if (optimal == target) {
-                found = true;
-                break;
+    void plan(Pose target) {
+        tracing::Span span{"plan", scene_id};
+        auto start = std::chrono::steady_clock::now();
+        PlanResult result = core.plan(
+            initial,
+            target,
+            [this]() {
+                return scene_queue->pending() || target_queue->version() != target_version;
+            },
+            [this](const std::vector<Pose>& path) {
+                publish(path);
             }
+        );
+        std::chrono::duration<double, std::micro> latency = std::chrono::steady_clock::now() - start;
+        const planning_core::PlanCounters& counters = core.counters();
 
-            state_space.expand_optimal();
+        if (result.total_tiles > 0) {
+            RCLCPP_DEBUG(
+                logger, "Distance field computed for %zu of %zu tiles", result.computed_tiles, result.total_tiles
+            );
+        }
+        if (result.cache_hit) {
+            RCLCPP_DEBUG(
+                logger, "Plan cache hit, %zu hits and %zu misses so far", counters.cache_hits, counters.cache_misses
+            );
+        }
+        if (result.bypassed) {
+            RCLCPP_DEBUG(
+                logger, "Last path is still clear, search bypassed for %.1f%% of plans",
+                100.0 * counters.bypassed_plans / (counters.bypassed_plans + counters.searched_plans)
+            );
+        }
+        if (result.overflow) {
+            RCLCPP_INFO(logger, "Search stopped at the %zu MB memory limit", memory_limit_mb);
         }
 
-        nav_msgs::msg::Path result;
-        if (found) {
-            State current = target;
-            while (current != initial) {
-                result.poses.push_back(current.to_pose_stamped());
-                current = state_space.origin[current];
-            }
+        switch (result.status) {
+        case PlanStatus::Preempted:
+            stale = true;
+            RCLCPP_DEBUG(
+                logger, "Plan preempted by newer data, %zu plans preempted so far", counters.preempted_plans
+            );
+            return;
+        case PlanStatus::TooManyStates:
+            RCLCPP_INFO(logger, "Scene has too many states to number");
+            break;
+        case PlanStatus::OutsideScene:
+            RCLCPP_INFO(logger, "Initial or target state is outside of the scene");
+            break;
+        case PlanStatus::OutOfMemory:
+            RCLCPP_INFO(logger, "Scene needs more than %zu MB of search memory", memory_limit_mb);
+            break;
+        case PlanStatus::Found:
+        case PlanStatus::NotFound:
+            break;
+        }
+        if (!result.reported) {
+            publish(result.path);
+        }
+        // Preempted plans have no result to compare against, so only finished ones are recorded.
+        if (recorder) {
+            recorder->write(core.scene(), core.cells(), initial, target, result, latency.count());
+        }
+        if (metadata_publisher) {
+            report_metadata(result, latency.count());
+        }
+    }
 
-            result.poses.push_back(current.to_pose_stamped());
-            std::reverse(result.poses.begin(), result.poses.end());
-        } else {
-            RCLCPP_INFO(logger, "No path found");
+    // Plans between messages are counted and their slowest time kept, the rest describes the
+    // last plan. Entries are key=value pairs in the debug field.
+    void report_metadata(const PlanResult& result, double wall_us) {
+        ++metadata_plans;
+        metadata_max_wall_us = std::max(metadata_max_wall_us, wall_us);
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_metadata < metadata_period) {
+            return;
         }
-        return result;
+        last_metadata = now;
+
+        using microseconds = std::chrono::duration<double, std::micro>;
+        const planning_core::PlanCounters& counters = core.counters();
+        auto message = std::make_unique<msg::MetaData>();
+        message->created_at = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+        message->debug = {
+            "plans=" + std::to_string(metadata_plans),
+            "max_wall_us=" + std::to_string(metadata_max_wall_us),
+            "status=" + std::string(status_name(result.status)),
+            "wall_us=" + std::to_string(wall_us),
+            "queue_wait_us=" + std::to_string(microseconds(queue_wait).count()),
+            "scene_age_us=" + std::to_string(microseconds(now - scene_received).count()),
+            "expansions=" + std::to_string(result.expansions),
+            "open_peak=" + std::to_string(result.stats.open_peak),
+            "closed_peak=" + std::to_string(result.stats.closed_peak),
+            "collision_checks=" + std::to_string(result.stats.collision_checks),
+            "cache_hit=" + std::to_string(result.cache_hit),
+            "bypassed=" + std::to_string(result.bypassed),
+            "cache_hits=" + std::to_string(counters.cache_hits),
+            "cache_misses=" + std::to_string(counters.cache_misses),
+            "preempted_plans=" + std::to_string(counters.preempted_plans),
+            "dropped_scenes=" + std::to_string(scene_queue->dropped()),
+        };
+        metadata_publisher->publish(std::move(message));
+
+        metadata_plans = 0;
+        metadata_max_wall_us = 0.0;
     }
 
-    void start() {
-        std::optional<msg::Scene::SharedPtr> scene;
-        while ((scene = scene_queue->take()).has_value()) {
-            CollisionTester tester{scene.value()};
-            std::optional<msg::Point::SharedPtr> target_point = target_queue->peek();
-            if (!target_point.has_value()) {
-                RCLCPP_DEBUG(logger, "No target in the topic, skipping planning");
-                continue;
-            }
-            State target = State::from_point(target_point.value());
+    // Ownership goes to the publisher, so in-process subscribers get the message without a copy.
+    void publish(const std::vector<Pose>& path) {
+        if (path.empty()) {
+            RCLCPP_INFO(logger, "No path found");
+        }
+        auto path_message = std::make_unique<msg::Path>();
+        path_message->path.poses.resize(path.size());
+        for (size_t i = 0; i < path.size(); ++i) {
+            path_message->path.poses[i] = to_pose_stamped(path[i]);
+        }
+        path_message->created_at = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+        path_message->scene_id = scene_id;
 
-            msg::Path path;
+        path_publisher->publish(std::move(path_message));
+        tracing::instant("path published", scene_id);
+    }
 
-            path.path = plan(tester, primitives, initial, target);
-            path.created_at = std::chrono::duration_cast<std::chrono::seconds>(
-                std::chrono::system_clock::now().time_since_epoch()
-            ).count();
+    void start() {
+        tracing::name_thread("planner");
+        std::optional<SceneUpdate> update;
+        while ((update = scene_queue->take()).has_value()) {
+            RCLCPP_DEBUG(
+                logger, "Planning for a new scene, %zu scenes dropped unplanned so far",
+                static_cast<size_t>(scene_queue->dropped())
+            );
+            scene_received = update->received;
+            queue_wait = std::chrono::steady_clock::now() - scene_received;
+            receive_scene(*update);
+
+            // Plan preempted by a new target is restarted right away with the same scene.
+            do {
+                target_version = target_queue->version();
+                std::optional<msg::Point::ConstSharedPtr> target_point = target_queue->peek();
+                if (!target_point.has_value()) {
+                    RCLCPP_DEBUG(logger, "No target in the topic, skipping planning");
+                    break;
+                }
+                const msg::Point& target = *target_point.value();
 
-            path_publisher->publish(path);
+                stale = false;
+                plan(Pose{target.x, target.y, target.theta});
+            } while (stale && !scene_queue->pending());
         }
     }
 
 private:
-    std::shared_ptr<SingleSlotQueue<msg::Scene::SharedPtr>> scene_queue;
-    std::shared_ptr<SingleSlotQueue<msg::Point::SharedPtr>> target_queue;
+    std::shared_ptr<Mailbox<SceneUpdate>> scene_queue;
+    std::shared_ptr<Mailbox<msg::Point::ConstSharedPtr>> target_queue;
     rclcpp::Publisher<msg::Path>::SharedPtr path_publisher;
+    rclcpp::Publisher<msg::MetaData>::SharedPtr metadata_publisher;
     rclcpp::Logger logger;
-    MotionPrimitives primitives;
-    State initial;
+    planning_core::Planner core;
+    Pose initial;
+    size_t memory_limit_mb;
+    std::unique_ptr<planning_core::ScenarioWriter> recorder;
+
+    uint64_t target_version = 0;
+    bool stale = false;
+
+    msg::Scene::ConstSharedPtr scene_keyframe;
+    size_t applied_deltas = 0;
+    // Id of the newest scene message applied, carried by the paths planned on it.
+    uint64_t scene_id = 0;
+
+    // Time the planned scene spent in the mailbox before planning started.
+    std::chrono::steady_clock::duration queue_wait{};
+    std::chrono::steady_clock::time_point scene_received;
+    std::chrono::steady_clock::duration metadata_period{};
+    std::chrono::steady_clock::time_point last_metadata;
+    size_t metadata_plans = 0;
+    double metadata_max_wall_us = 0.0;
 };
 
 std::thread start_planner(
-    std::shared_ptr<SingleSlotQueue<msg::Scene::SharedPtr>> scene_queue,
-    std::shared_ptr<SingleSlotQueue<msg::Point::SharedPtr>> target_queue,
+    std::shared_ptr<Mailbox<SceneUpdate>> scene_queue,
+    std::shared_ptr<Mailbox<msg::Point::ConstSharedPtr>> target_queue,
     rclcpp::Publisher<msg::Path>::SharedPtr path_publisher,
+    rclcpp::Publisher<msg::MetaData>::SharedPtr metadata_publisher,
+    double metadata_rate_hz,
     std::string config_path,
+    std::string scenario_log_path,
     rclcpp::Logger logger
 ) {
     auto planner_func = [=]() {
-        Planner planner{scene_queue, target_queue, path_publisher, config_path, logger};
+        Planner planner{
+            scene_queue, target_queue, path_publisher, metadata_publisher, metadata_rate_hz,
+            read_config(config_path), scenario_log_path, logger
+        };
         planner.start();
     };
     return std::thread{planner_func};
@@ -1,23 +1,41 @@
 #pragma once
+#include "mailbox.hpp"
+#include "planning_interfaces/msg/meta_data.hpp"
 #include "planning_interfaces/msg/path.hpp"
 #include "planning_interfaces/msg/point.hpp"
 #include "planning_interfaces/msg/scene.hpp"
+#include "planning_interfaces/msg/scene_delta.hpp"
 #include "rclcpp/rclcpp.hpp"
-#include "single_slot_queue.hpp"
 
+#include <chrono>
 #include <memory>
+#include <string>
 #include <thread>
+#include <vector>
 
 
 namespace planning_node {
 
 using namespace planning_interfaces;
 
+// Last keyframe and the deltas received on top of it, each delta based on the one before. Every
+// update is complete, so the planner may skip some and still patch its grid from the newest.
+struct SceneUpdate {
+    msg::Scene::ConstSharedPtr keyframe;
+    std::vector<msg::SceneDelta::ConstSharedPtr> deltas;
+    // When the node received the newest message of the update.
+    std::chrono::steady_clock::time_point received;
+};
+
 std::thread start_planner(
-    std::shared_ptr<SingleSlotQueue<msg::Scene::SharedPtr>> scene_queue,
-    std::shared_ptr<SingleSlotQueue<msg::Point::SharedPtr>> target_queue,
+    std::shared_ptr<Mailbox<SceneUpdate>> scene_queue,
+    std::shared_ptr<Mailbox<msg::Point::ConstSharedPtr>> target_queue,
     rclcpp::Publisher<msg::Path>::SharedPtr path_publisher,
+    // Null unless plan metadata is published, at most metadata_rate_hz messages a second.
+    rclcpp::Publisher<msg::MetaData>::SharedPtr metadata_publisher,
+    double metadata_rate_hz,
     std::string config_path,
+    std::string scenario_log_path,
     rclcpp::Logger logger
 );
 
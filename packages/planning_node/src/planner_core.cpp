@@ -0,0 +1,1690 @@
+#include "planner_core.hpp"
+
+#include "batch_collision.hpp"
+#include "content_hash.hpp"
+#include "indexed_heap.hpp"
+#include "lru_cache.hpp"
+#include "nlohmann/json.hpp"
+#include "occupancy_bitmap.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+using planning_core::GridInfo;
+using planning_core::GridRegion;
+
+using nlohmann::json;
+
+double mod_interval(double x, double modulo) {
+    return std::fmod(std::fmod(x, modulo) + modulo, modulo);
+}
+
+struct State {
+    double x;
+    double y;
+    double theta;
+
+    static State from_json(const json& state) {
+        return State{
+            state["x"],
+            state["y"],
+            mod_interval(state["theta"], 2 * M_PI),
+        };
+    }
+
+    static State from_pose(planning_core::Pose pose) {
+        return State{
+            pose.x,
+            pose.y,
+            mod_interval(pose.theta, 2 * M_PI),
+        };
+    }
+
+    planning_core::Pose to_pose() const {
+        return planning_core::Pose{x, y, theta};
+    }
+
+    json to_json() const {
+        json state;
+        state["x"] = x;
+        state["y"] = y;
+        state["theta"] = theta;
+        return state;
+    }
+
+    State rotate(double angle) const {
+        return State{
+            std::cos(angle) * x - std::sin(angle) * y,
+            std::sin(angle) * x + std::cos(angle) * y,
+            theta + angle,
+        };
+    }
+
+};
+
+struct Cell {
+    int x;
+    int y;
+    int theta;
+};
+
+// Discretization of the (x, y, theta) space over the occupancy grid cells:
+// every grid cell is split into `headings` equal heading bins.
+// Ids of the same grid cell are adjacent, so `id / headings` is the grid data index.
+struct Lattice {
+    using Id = uint32_t;
+
+    double origin_x;
+    double origin_y;
+    double resolution;
+    int width;
+    int height;
+    int headings;
+
+    static Lattice from_grid(const GridInfo& info, int headings) {
+        return Lattice{info.origin_x, info.origin_y, info.resolution, info.width, info.height, headings};
+    }
+
+    size_t size() const {
+        return static_cast<size_t>(width) * height * headings;
+    }
+
+    // Whether ids of both lattices refer to the same states.
+    bool matches(const Lattice& other) const {
+        return origin_x == other.origin_x && origin_y == other.origin_y && resolution == other.resolution &&
+            width == other.width && height == other.height && headings == other.headings;
+    }
+
+    bool contains(int x, int y) const {
+        return x >= 0 && x < width && y >= 0 && y < height;
+    }
+
+    std::optional<Cell> quantize(State state) const {
+        double x = std::floor((state.x - origin_x) / resolution);
+        double y = std::floor((state.y - origin_y) / resolution);
+        if (!(x >= 0 && x < width && y >= 0 && y < height)) {
+            return std::nullopt;
+        }
+
+        int theta = static_cast<int>(std::lround(state.theta / heading_step())) % headings;
+        return Cell{static_cast<int>(x), static_cast<int>(y), theta};
+    }
+
+    Id index(Cell cell) const {
+        return (static_cast<Id>(cell.y) * width + cell.x) * headings + cell.theta;
+    }
+
+    Cell cell(Id index) const {
+        Id grid_index = index / headings;
+        return Cell{
+            static_cast<int>(grid_index % width),
+            static_cast<int>(grid_index / width),
+            static_cast<int>(index % headings),
+        };
+    }
+
+    State center(Cell cell) const {
+        return State{
+            origin_x + (cell.x + 0.5) * resolution,
+            origin_y + (cell.y + 0.5) * resolution,
+            cell.theta * heading_step(),
+        };
+    }
+
+    double heading_step() const {
+        return 2 * M_PI / headings;
+    }
+};
+
+struct MotionPrimitive {
+    double dx;
+    double dy;
+    double dtheta;
+
+    double weight;
+
+    static MotionPrimitive from_json(const json& primitive) {
+        return MotionPrimitive{
+            primitive["dx"],
+            primitive["dy"],
+            mod_interval(primitive["dtheta"], 2 * M_PI),
+            primitive["weight"],
+        };
+    }
+
+    // Offset after travelling the given fraction of the primitive from the origin facing +x.
+    // Primitive follows the circular arc tangent to the initial heading through (dx, dy),
+    // or a straight segment when there is no lateral displacement.
+    State offset_at(double fraction) const {
+        if (dy == 0.0 || dx <= 0.0) {
+            return State{dx * fraction, dy * fraction, dtheta * fraction};
+        }
+
+        double radius = (dx * dx + dy * dy) / (2 * dy);
+        double angle = 2 * std::atan2(dy, dx) * fraction;
+        return State{radius * std::sin(angle), radius * (1 - std::cos(angle)), dtheta * fraction};
+    }
+
+    double length() const {
+        if (dy == 0.0 || dx <= 0.0) {
+            return std::hypot(dx, dy);
+        }
+        return std::abs((dx * dx + dy * dy) / (2 * dy) * 2 * std::atan2(dy, dx));
+    }
+};
+
+using MotionPrimitives = std::vector<MotionPrimitive>;
+
+// Vehicle shape approximated by circles, centers are given in the vehicle frame.
+struct Footprint {
+    struct Circle {
+        double x;
+        double y;
+        double radius;
+    };
+
+    std::vector<Circle> circles;
+
+    static Footprint from_json(const json& footprint) {
+        Footprint result;
+        for (const json& circle : footprint["circles"]) {
+            result.circles.push_back(Circle{circle["x"], circle["y"], circle["radius"]});
+        }
+        return result;
+    }
+
+    double reach() const {
+        double result = 0.0;
+        for (const Circle& circle : circles) {
+            result = std::max(result, std::hypot(circle.x, circle.y));
+        }
+        return result;
+    }
+};
+
+// Motion primitives rotated to every heading bin and rasterized for a grid resolution.
+// Expanding a lattice cell is then a matter of integer offsets: each entry knows the cell it
+// ends in, the heading it ends with and which distance field cells must have what clearance
+// for the footprint to pass along the primitive.
+struct PrimitiveTable {
+    struct Offset {
+        int dx;
+        int dy;
+    };
+
+    // The cell at the offset is clear of obstacles if the distance from its center to the
+    // nearest obstacle is at least the clearance. Checks cover the cells footprint circles
+    // overlap and ask for half a cell, i.e. for the cell to be free.
+    struct Check {
+        Offset offset;
+        float clearance;
+    };
+
+    struct Entry {
+        Offset end;
+        int theta;
+        double weight;
+        uint32_t checks_begin;
+        uint32_t checks_end;
+    };
+
+    static PrimitiveTable build(
+        const MotionPrimitives& primitives, const Footprint& footprint, int headings, double resolution
+    ) {
+        if (primitives.size() > max_primitives) {
+            throw std::invalid_argument("At most 64 motion primitives are supported");
+        }
+
+        PrimitiveTable table;
+        table.headings = headings;
+        table.resolution = resolution;
+        table.primitive_count = primitives.size();
+
+        double heading_step = 2 * M_PI / headings;
+        auto to_cell = [resolution](double offset) {
+            return static_cast<int>(std::floor(0.5 + offset / resolution));
+        };
+        // Distance from a point to the edges of the cell at an offset, zero inside it.
+        auto to_edge = [resolution](double offset, int cell) {
+            return std::max(std::abs(offset - cell * resolution) - resolution / 2, 0.0);
+        };
+
+        for (int heading = 0; heading < headings; ++heading) {
+            for (const MotionPrimitive& primitive : primitives) {
+                Entry entry;
+                State end = primitive.offset_at(1.0).rotate(heading * heading_step);
+                entry.end = Offset{to_cell(end.x), to_cell(end.y)};
+                entry.theta = static_cast<int>(
+                    mod_interval(heading + std::lround(primitive.dtheta / heading_step), headings)
+                );
+                entry.weight = primitive.weight;
+                entry.checks_begin = static_cast<uint32_t>(table.checks.size());
+
+                // Circle centers move at most the spacing between samples, so circles grown by
+                // half of it cover the footprint in between.
+                double travel = primitive.length() + std::abs(primitive.dtheta) * footprint.reach();
+                int samples = std::max(1, static_cast<int>(std::ceil(8 * travel / resolution)));
+                double spacing = travel / samples;
+                for (int sample = 1; sample <= samples; ++sample) {
+                    State pose = primitive.offset_at(static_cast<double>(sample) / samples).rotate(heading * heading_step);
+                    for (const Footprint::Circle& circle : footprint.circles) {
+                        State center = State{circle.x, circle.y, 0.0}.rotate(pose.theta);
+                        center.x += pose.x;
+                        center.y += pose.y;
+
+                        // Cells the circle overlaps, touching an edge doesn't count.
+                        double radius = circle.radius + spacing / 2;
+                        for (int dy = to_cell(center.y - radius); dy <= to_cell(center.y + radius); ++dy) {
+                            for (int dx = to_cell(center.x - radius); dx <= to_cell(center.x + radius); ++dx) {
+                                if (std::hypot(to_edge(center.x, dx), to_edge(center.y, dy)) < radius) {
+                                    table.add_check(
+                                        entry.checks_begin, Check{Offset{dx, dy}, static_cast<float>(resolution / 2)}
+                                    );
+                                }
+                            }
+                        }
+                    }
+                }
+
+                entry.checks_end = static_cast<uint32_t>(table.checks.size());
+                table.entries.push_back(entry);
+            }
+        }
+
+        for (const Check& check : table.checks) {
+            table.max_clearance = std::max(table.max_clearance, check.clearance);
+            table.padding = std::max({table.padding, std::abs(check.offset.dx), std::abs(check.offset.dy)});
+        }
+
+        // Checks of the entries starting with a heading are adjacent, so a node's are one run.
+        table.check_clearance.resize(table.checks.size());
+        table.check_owner.resize(table.checks.size());
+        table.heading_checks.assign(headings + 1, 0);
+        for (uint32_t i = 0; i < table.entries.size(); ++i) {
+            const Entry& entry = table.entries[i];
+            for (uint32_t j = entry.checks_begin; j < entry.checks_end; ++j) {
+                table.check_clearance[j] = table.checks[j].clearance;
+                table.check_owner[j] = static_cast<uint8_t>(i % table.primitive_count);
+            }
+            table.heading_checks[table.start_heading(i) + 1] = entry.checks_end;
+        }
+
+        table.incoming_begin.assign(headings + 1, 0);
+        for (const Entry& entry : table.entries) {
+            ++table.incoming_begin[entry.theta + 1];
+        }
+        for (int heading = 0; heading < headings; ++heading) {
+            table.incoming_begin[heading + 1] += table.incoming_begin[heading];
+        }
+        table.incoming.resize(table.entries.size());
+        std::vector<uint32_t> filled(table.incoming_begin.begin(), table.incoming_begin.end() - 1);
+        for (uint32_t i = 0; i < table.entries.size(); ++i) {
+            table.incoming[filled[table.entries[i].theta]++] = i;
+        }
+        return table;
+    }
+
+    const Entry* begin(int heading) const {
+        return entries.data() + heading * primitive_count;
+    }
+
+    const Entry* end(int heading) const {
+        return begin(heading) + primitive_count;
+    }
+
+    int start_heading(uint32_t entry) const {
+        return static_cast<int>(entry / primitive_count);
+    }
+
+    // Turns check offsets into flat offsets for a row-major distance field with the row stride.
+    void index(int new_stride) {
+        stride = new_stride;
+        check_index.resize(checks.size());
+        for (size_t i = 0; i < checks.size(); ++i) {
+            check_index[i] = checks[i].offset.dy * stride + checks[i].offset.dx;
+        }
+    }
+
+    int headings = 0;
+    double resolution = 0.0;
+    size_t primitive_count = 0;
+    std::vector<Entry> entries;
+    std::vector<Check> checks;
+    float max_clearance = 0.0f;
+
+    // Checks reach at most padding cells away from the start cell along either axis.
+    int padding = 0;
+
+    // Checks split into flat arrays for batch queries: the flat offset of the checked cell,
+    // the clearance and the position of the owning entry among the entries of its heading.
+    int stride = 0;
+    std::vector<int32_t> check_index;
+    std::vector<float> check_clearance;
+    std::vector<uint8_t> check_owner;
+    std::vector<uint32_t> heading_checks;
+
+    // Indices of entries ending with each heading, for walking the lattice backwards.
+    std::vector<uint32_t> incoming;
+    std::vector<uint32_t> incoming_begin;
+
+private:
+    // Collisions of the entries of a heading are reported as bits of a 64-bit mask.
+    static constexpr size_t max_primitives = 64;
+
+    // Keeps one check per cell with the largest clearance.
+    void add_check(uint32_t from, Check check) {
+        for (auto it = checks.begin() + from; it != checks.end(); ++it) {
+            if (it->offset.dx == check.offset.dx && it->offset.dy == check.offset.dy) {
+                it->clearance = std::max(it->clearance, check.clearance);
+                return;
+            }
+        }
+        checks.push_back(check);
+    }
+};
+
+// Euclidean distance from every cell center to the nearest occupied cell center, in meters,
+// capped at the limit since checks never need more. Built once per scene with the linear-time
+// Felzenszwalb-Huttenlocher transform, the storage is kept between scenes. The grid is
+// surrounded by a border of zero distance, so checks reaching at most padding cells out of
+// the grid fail without bounds tests.
+//
+// The transform runs per tile over the tile and the margin within the limit around it. Tiles
+// the pyramid shows no obstacles near are just filled with the limit, so the work grows with
+// the obstacles in the scene rather than its area, and a patched scene only recomputes the tiles
+// near the cells it changed.
+struct DistanceField {
+    static constexpr int tile = 64;
+
+    void build(const OccupancyPyramid& occupancy, double resolution, int new_padding, float new_limit) {
+        width = occupancy.grid().width;
+        height = occupancy.grid().height;
+        padding = new_padding;
+        stride = width + 2 * padding;
+        limit = new_limit;
+        distance.assign(static_cast<size_t>(stride) * (height + 2 * padding), 0.0f);
+
+        margin = static_cast<int>(std::ceil(limit / resolution));
+        size_t window = static_cast<size_t>(tile + 2 * margin);
+        squared.resize(window * window);
+        input.resize(window);
+        output.resize(window);
+        parabolas.resize(window);
+        bounds.resize(window + 1);
+
+        computed_tiles = 0;
+        total_tiles = 0;
+        for (int y0 = 0; y0 < height; y0 += tile) {
+            for (int x0 = 0; x0 < width; x0 += tile) {
+                update_tile(occupancy, resolution, x0, y0);
+            }
+        }
+    }
+
+    // Recomputes the tiles within the limit of the changed cells, the rest keep their distances.
+    // The occupancy must keep the size and the parameters the field was built for.
+    void update(const OccupancyPyramid& occupancy, double resolution, const GridRegion& changed) {
+        computed_tiles = 0;
+        total_tiles = 0;
+        if (changed.empty()) {
+            return;
+        }
+        int tile_x0 = std::max(changed.x0 - margin, 0) / tile;
+        int tile_y0 = std::max(changed.y0 - margin, 0) / tile;
+        int tile_x1 = std::min(changed.x1 + margin, width - 1) / tile;
+        int tile_y1 = std::min(changed.y1 + margin, height - 1) / tile;
+        for (int y = tile_y0; y <= tile_y1; ++y) {
+            for (int x = tile_x0; x <= tile_x1; ++x) {
+                update_tile(occupancy, resolution, x * tile, y * tile);
+            }
+        }
+    }
+
+    // Position of the cell in distance, valid for cells up to padding cells out of the grid.
+    size_t index(int x, int y) const {
+        return static_cast<size_t>(y + padding) * stride + x + padding;
+    }
+
+    float at(int x, int y) const {
+        return distance[index(x, y)];
+    }
+
+    int width = 0;
+    int height = 0;
+    int padding = 0;
+    int stride = 0;
+    float limit = 0.0f;
+    std::vector<float> distance;
+    size_t computed_tiles = 0;
+    size_t total_tiles = 0;
+
+private:
+    static constexpr double far = 1e20;
+
+    void update_tile(const OccupancyPyramid& occupancy, double resolution, int x0, int y0) {
+        int x1 = std::min(x0 + tile, width) - 1;
+        int y1 = std::min(y0 + tile, height) - 1;
+        ++total_tiles;
+        if (occupancy.free(x0 - margin, y0 - margin, x1 + margin, y1 + margin)) {
+            for (int y = y0; y <= y1; ++y) {
+                std::fill_n(distance.begin() + index(x0, y), x1 - x0 + 1, limit);
+            }
+            return;
+        }
+        ++computed_tiles;
+        build_tile(occupancy.grid(), resolution, x0, y0, x1, y1);
+    }
+
+    // Obstacles closer than the limit to the tile lie within the margin, the rest are left out.
+    void build_tile(const OccupancyBitmap& occupancy, double resolution, int x0, int y0, int x1, int y1) {
+        int window_x = std::max(x0 - margin, 0);
+        int window_y = std::max(y0 - margin, 0);
+        int window_width = std::min(x1 + margin, width - 1) - window_x + 1;
+        int window_height = std::min(y1 + margin, height - 1) - window_y + 1;
+
+        for (int x = 0; x < window_width; ++x) {
+            for (int y = 0; y < window_height; ++y) {
+                input[y] = occupancy.test(window_x + x, window_y + y) ? 0.0 : far;
+            }
+            transform(window_height);
+            for (int y = 0; y < window_height; ++y) {
+                squared[static_cast<size_t>(y) * window_width + x] = output[y];
+            }
+        }
+
+        for (int y = y0; y <= y1; ++y) {
+            std::copy_n(squared.begin() + static_cast<size_t>(y - window_y) * window_width, window_width, input.begin());
+            transform(window_width);
+            float* row = distance.data() + index(0, y);
+            for (int x = x0; x <= x1; ++x) {
+                row[x] = std::min(static_cast<float>(std::sqrt(output[x - window_x]) * resolution), limit);
+            }
+        }
+    }
+
+    // 1D squared distance transform of input into output as a lower envelope of parabolas.
+    void transform(int n) {
+        int k = 0;
+        parabolas[0] = 0;
+        bounds[0] = -std::numeric_limits<double>::infinity();
+        bounds[1] = std::numeric_limits<double>::infinity();
+        for (int q = 1; q < n; ++q) {
+            double s = intersection(q, parabolas[k]);
+            while (s <= bounds[k]) {
+                --k;
+                s = intersection(q, parabolas[k]);
+            }
+            ++k;
+            parabolas[k] = q;
+            bounds[k] = s;
+            bounds[k + 1] = std::numeric_limits<double>::infinity();
+        }
+
+        k = 0;
+        for (int q = 0; q < n; ++q) {
+            while (bounds[k + 1] < q) {
+                ++k;
+            }
+            int v = parabolas[k];
+            output[q] = static_cast<double>(q - v) * (q - v) + input[v];
+        }
+    }
+
+    double intersection(int q, int v) const {
+        return ((input[q] + static_cast<double>(q) * q) - (input[v] + static_cast<double>(v) * v)) / (2.0 * (q - v));
+    }
+
+    int margin = 0;
+    std::vector<double> squared;
+    std::vector<double> input;
+    std::vector<double> output;
+    std::vector<int> parabolas;
+    std::vector<double> bounds;
+};
+
+// Collision queries over the scene converted on arrival. Primitive checks need the table indexed
+// for the field stride and padded by the field for its reach, see PrimitiveTable::index.
+struct CollisionTester {
+    CollisionTester(const OccupancyBitmap& occupancy, const DistanceField& field)
+      : occupancy(&occupancy), field(&field) {
+    }
+
+    // Cell must lie inside the grid, see Lattice::quantize.
+    bool test(Cell cell) const {
+        return occupancy->test(cell.x, cell.y);
+    }
+
+    // Every later lookup is added to the counter, a null counter turns counting off.
+    void count_checks(uint64_t* counter) {
+        checks = counter;
+    }
+
+    // Whether the footprint moved along the primitive from the cell leaves the grid or hits an obstacle.
+    bool test(Cell from, const PrimitiveTable& table, const PrimitiveTable::Entry& entry) const {
+        if (checks) {
+            *checks += entry.checks_end - entry.checks_begin;
+        }
+        const float* distance = field->distance.data() + field->index(from.x, from.y);
+        for (uint32_t i = entry.checks_begin; i < entry.checks_end; ++i) {
+            if (distance[table.check_index[i]] < table.check_clearance[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Same for all primitives from the cell at once, bit k is set if the k-th entry of the heading collides.
+    uint64_t test_all(Cell from, const PrimitiveTable& table) const {
+        uint32_t begin = table.heading_checks[from.theta];
+        uint32_t end = table.heading_checks[from.theta + 1];
+        if (checks) {
+            *checks += end - begin;
+        }
+        return find_collisions(
+            field->distance.data() + field->index(from.x, from.y),
+            table.check_index.data() + begin,
+            table.check_clearance.data() + begin,
+            table.check_owner.data() + begin,
+            end - begin
+        );
+    }
+
+private:
+    const OccupancyBitmap* occupancy;
+    const DistanceField* field;
+    uint64_t* checks = nullptr;
+};
+
+// Whether the footprint can still move along the lattice path, one batch query per state.
+// Consecutive states not joined by any primitive make the path invalid as well.
+bool path_clear(
+    Lattice lattice, CollisionTester tester, const PrimitiveTable& table, const std::vector<Lattice::Id>& path
+) {
+    for (size_t i = 0; i + 1 < path.size(); ++i) {
+        Cell from = lattice.cell(path[i]);
+        Cell to = lattice.cell(path[i + 1]);
+        uint64_t collisions = tester.test_all(from, table);
+        const PrimitiveTable::Entry* entry = table.begin(from.theta);
+        while (entry != table.end(from.theta) &&
+               (from.x + entry->end.dx != to.x || from.y + entry->end.dy != to.y || entry->theta != to.theta ||
+                (collisions >> (entry - table.begin(from.theta))) & 1)) {
+            ++entry;
+        }
+        if (entry == table.end(from.theta)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+enum class HeuristicType {
+    None,
+    Euclidean,
+    Grid,
+};
+
+HeuristicType heuristic_type_from_json(const json& type) {
+    if (type == "none") {
+        return HeuristicType::None;
+    } else if (type == "euclidean") {
+        return HeuristicType::Euclidean;
+    } else if (type == "grid") {
+        return HeuristicType::Grid;
+    }
+    throw std::invalid_argument("Unknown heuristic type: " + type.dump());
+}
+
+enum class SearchMode {
+    AStar,
+    Incremental,
+    Anytime,
+};
+
+SearchMode search_mode_from_json(const json& mode) {
+    if (mode == "astar") {
+        return SearchMode::AStar;
+    } else if (mode == "incremental") {
+        return SearchMode::Incremental;
+    } else if (mode == "anytime") {
+        return SearchMode::Anytime;
+    }
+    throw std::invalid_argument("Unknown search mode: " + mode.dump());
+}
+
+struct AnytimeParameters {
+    std::chrono::milliseconds deadline;
+    double initial_inflation;
+    double inflation_step;
+
+    static AnytimeParameters from_json(const json& anytime) {
+        return AnytimeParameters{
+            std::chrono::milliseconds{anytime["deadline_ms"].get<int64_t>()},
+            anytime["initial_inflation"],
+            anytime["inflation_step"],
+        };
+    }
+};
+
+// Last path is kept while it stays collision-free and the target stays within the tolerance.
+struct RevalidationParameters {
+    bool enabled;
+    double target_tolerance;
+
+    static RevalidationParameters from_json(const json& revalidation) {
+        return RevalidationParameters{
+            revalidation["enabled"],
+            revalidation["target_tolerance_m"],
+        };
+    }
+};
+
+// Lower bound of the cost per meter of lattice motion, used to turn metric distances into costs.
+// Octile lengths bound the cost per meter of 8-connected grid distance instead, which exceeds the
+// straight line for primitives ending off the axes and diagonals, such as a knight's move.
+double heuristic_scale(const PrimitiveTable& table, bool octile = false) {
+    double scale = std::numeric_limits<double>::infinity();
+    for (const PrimitiveTable::Entry& entry : table.entries) {
+        double dx = std::abs(entry.end.dx);
+        double dy = std::abs(entry.end.dy);
+        double cells = octile ? std::max(dx, dy) + (std::sqrt(2.0) - 1.0) * std::min(dx, dy) : std::hypot(dx, dy);
+        double length = cells * table.resolution;
+        if (length > 0) {
+            scale = std::min(scale, entry.weight / length);
+        }
+    }
+    return std::isfinite(scale) ? scale : 0.0;
+}
+
+// Cost-to-go estimate shared by all headings of a grid cell.
+// Euclidean heuristic ignores obstacles and stays valid while the target does not move.
+// Grid heuristic adds an 8-connected Dijkstra from the target over cells that are not
+// entirely blocked, so it accounts for obstacles and marks cells the target can't be reached
+// from as infinite. Its steps are costed with the octile scale, see heuristic_scale. Large grids
+// are searched on the coarsest pyramid level of at most max_grid_cells cells, lowered by the
+// distance cell centers may be off from the coarse ones.
+// Dijkstra values are computed into caller-owned storage, the heuristic only refers to them.
+struct Heuristic {
+    static constexpr size_t max_grid_cells = 1 << 16;
+
+    Heuristic() = default;
+
+    static Heuristic none() {
+        return Heuristic{};
+    }
+
+    static Heuristic euclidean(Lattice lattice, Cell target, double scale) {
+        Heuristic heuristic;
+        heuristic.lattice = lattice;
+        heuristic.target = target;
+        heuristic.step = scale * lattice.resolution;
+        return heuristic;
+    }
+
+    static Heuristic grid(
+        Lattice lattice,
+        const OccupancyPyramid& occupancy,
+        Cell target,
+        double scale,
+        double octile_scale,
+        std::vector<double>& values,
+        IndexedHeap<double>& queue
+    ) {
+        static const int neighbours[8][2] = {
+            {1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1},
+        };
+
+        Heuristic heuristic = euclidean(lattice, target, scale);
+        while (heuristic.level + 1 < occupancy.levels() &&
+               static_cast<size_t>(occupancy.all(heuristic.level).width) * occupancy.all(heuristic.level).height >
+                   max_grid_cells) {
+            ++heuristic.level;
+        }
+        const OccupancyBitmap& blocked = occupancy.all(heuristic.level);
+        int cell_size = 1 << heuristic.level;
+        heuristic.grid_width = blocked.width;
+        double grid_step = octile_scale * lattice.resolution;
+        heuristic.slack = grid_step * std::sqrt(2.0) * (cell_size - 1);
+
+        values.assign(static_cast<size_t>(blocked.width) * blocked.height, std::numeric_limits<double>::infinity());
+        queue.reset(values.size());
+        auto grid_index = [&blocked](int x, int y) {
+            return static_cast<Lattice::Id>(y) * blocked.width + x;
+        };
+
+        Lattice::Id start = grid_index(target.x >> heuristic.level, target.y >> heuristic.level);
+        values[start] = 0.0;
+        queue.push(start, 0.0);
+        while (!queue.empty()) {
+            Lattice::Id current = queue.top();
+            double value = queue.top_priority();
+            queue.pop();
+
+            int x = current % blocked.width;
+            int y = current / blocked.width;
+            for (const auto& neighbour : neighbours) {
+                int nx = x + neighbour[0];
+                int ny = y + neighbour[1];
+                if (nx < 0 || nx >= blocked.width || ny < 0 || ny >= blocked.height || blocked.test(nx, ny)) {
+                    continue;
+                }
+
+                double next_value = value + grid_step * cell_size * std::hypot(neighbour[0], neighbour[1]);
+                Lattice::Id next = grid_index(nx, ny);
+                if (next_value < values[next]) {
+                    values[next] = next_value;
+                    queue.push(next, next_value);
+                }
+            }
+        }
+        heuristic.values = values.data();
+        return heuristic;
+    }
+
+    double operator()(Lattice::Id id) const {
+        if (step == 0.0) {
+            return 0.0;
+        }
+        Cell cell = lattice.cell(id);
+        double estimate = step * std::hypot(cell.x - target.x, cell.y - target.y);
+        if (values != nullptr) {
+            double value = values[static_cast<size_t>(cell.y >> level) * grid_width + (cell.x >> level)];
+            estimate = std::max(estimate, value - slack);
+        }
+        return estimate;
+    }
+
+private:
+    Lattice lattice{};
+    Cell target{};
+    double step = 0.0;
+    const double* values = nullptr;
+    int level = 0;
+    int grid_width = 0;
+    double slack = 0.0;
+};
+
+// Search storage owned by the planner and reused between planning cycles. States get slots
+// in the order the search reaches them and an open-addressing table maps lattice ids to slots,
+// so memory and resetting follow the number of states touched rather than the lattice size.
+struct SearchArena {
+    using Id = Lattice::Id;
+    using Slot = uint32_t;
+
+    static constexpr Slot no_slot = std::numeric_limits<Slot>::max();
+
+    // Slot arrays, the open set position and two table buckets of load at most one half.
+    static constexpr size_t state_memory =
+        sizeof(Id) + sizeof(double) * 2 + sizeof(Slot) * 4 + sizeof(uint8_t);
+
+    // Forgets the states of the previous search, at most max_states can be added.
+    void reset(size_t new_max_states) {
+        for (Slot slot = 0; slot < ids.size(); ++slot) {
+            size_t bucket = home(ids[slot]);
+            while (table[bucket] != slot) {
+                bucket = (bucket + 1) & mask();
+            }
+            table[bucket] = no_slot;
+        }
+        max_states = new_max_states;
+        overflow = false;
+        ids.clear();
+        distance.clear();
+        origin.clear();
+        closed.clear();
+        open_set.reset(0);
+        inconsistent.clear();
+    }
+
+    Slot find(Id id) const {
+        if (table.empty()) {
+            return no_slot;
+        }
+        for (size_t bucket = home(id);; bucket = (bucket + 1) & mask()) {
+            if (table[bucket] == no_slot || ids[table[bucket]] == id) {
+                return table[bucket];
+            }
+        }
+    }
+
+    // Adds a state not stored yet, returns no_slot and sets overflow once max_states are stored.
+    Slot add(Id id) {
+        if (ids.size() >= max_states) {
+            overflow = true;
+            return no_slot;
+        }
+        if (2 * (ids.size() + 1) > table.size()) {
+            rehash(std::max<size_t>(2 * table.size(), 1024));
+        }
+
+        Slot slot = static_cast<Slot>(ids.size());
+        size_t bucket = home(id);
+        while (table[bucket] != no_slot) {
+            bucket = (bucket + 1) & mask();
+        }
+        table[bucket] = slot;
+        ids.push_back(id);
+        distance.push_back(std::numeric_limits<double>::infinity());
+        origin.push_back(no_slot);
+        closed.push_back(0);
+        open_set.grow(ids.size());
+        return slot;
+    }
+
+    size_t size() const {
+        return ids.size();
+    }
+
+    size_t max_states = 0;
+    bool overflow = false;
+
+    std::vector<Id> ids;
+    std::vector<double> distance;
+    std::vector<Slot> origin;
+    std::vector<uint8_t> closed;
+    IndexedHeap<double> open_set;
+    std::vector<Slot> inconsistent;
+
+    std::vector<double> heuristic;
+    IndexedHeap<double> heuristic_queue;
+
+    std::vector<Id> path;
+
+private:
+    size_t mask() const {
+        return table.size() - 1;
+    }
+
+    size_t home(Id id) const {
+        return (static_cast<uint64_t>(id) * 0x9E3779B97F4A7C15) >> 32 & mask();
+    }
+
+    void rehash(size_t buckets) {
+        table.assign(buckets, no_slot);
+        for (Slot slot = 0; slot < ids.size(); ++slot) {
+            size_t bucket = home(ids[slot]);
+            while (table[bucket] != no_slot) {
+                bucket = (bucket + 1) & mask();
+            }
+            table[bucket] = slot;
+        }
+    }
+
+    std::vector<Slot> table;
+};
+
+// Search state lives in the arena, which must be reset beforehand.
+struct StateSpace {
+    using Id = Lattice::Id;
+    using Slot = SearchArena::Slot;
+
+    StateSpace(
+        Lattice lattice, CollisionTester tester, Heuristic heuristic, const PrimitiveTable& table, SearchArena& arena
+    ) : lattice{lattice}
+      , tester{tester}
+      , heuristic{heuristic}
+      , table{table}
+      , arena{arena} {
+    }
+
+    Id get_optimal() const {
+        return arena.ids[arena.open_set.top()];
+    }
+
+    void expand_optimal() {
+        Slot optimal = arena.open_set.top();
+        arena.open_set.pop();
+        arena.closed[optimal] = 1;
+
+        Cell cell = lattice.cell(arena.ids[optimal]);
+        uint64_t collisions = tester.test_all(cell, table);
+        for (const PrimitiveTable::Entry* entry = table.begin(cell.theta); entry != table.end(cell.theta); ++entry) {
+            Cell next_cell{cell.x + entry->end.dx, cell.y + entry->end.dy, entry->theta};
+            bool collides = (collisions >> (entry - table.begin(cell.theta))) & 1;
+            if (collides || !lattice.contains(next_cell.x, next_cell.y)) {
+                continue;
+            }
+
+            Id next_id = lattice.index(next_cell);
+            Slot next = arena.find(next_id);
+            double next_distance = arena.distance[optimal] + entry->weight;
+            if (next != SearchArena::no_slot && next_distance >= arena.distance[next]) {
+                continue;
+            }
+            double estimate = heuristic(next_id);
+            if (std::isinf(estimate)) {
+                continue;
+            }
+            if (next == SearchArena::no_slot && (next = arena.add(next_id)) == SearchArena::no_slot) {
+                continue;
+            }
+            arena.distance[next] = next_distance;
+            arena.origin[next] = optimal;
+            if (arena.closed[next]) {
+                arena.inconsistent.push_back(next);
+            } else {
+                arena.open_set.push(next, next_distance + inflation * estimate);
+            }
+        }
+    }
+
+    // Starts the next search iteration with another inflation, reusing all distances found so far.
+    void restart(double new_inflation) {
+        inflation = new_inflation;
+        for (Slot slot : arena.inconsistent) {
+            arena.open_set.push(slot, 0.0);
+        }
+        arena.inconsistent.clear();
+        std::fill(arena.closed.begin(), arena.closed.end(), 0);
+        arena.open_set.reprioritize([this](Slot slot) {
+            return arena.distance[slot] + inflation * heuristic(arena.ids[slot]);
+        });
+    }
+
+    double distance(Id id) const {
+        Slot slot = arena.find(id);
+        return slot == SearchArena::no_slot ? std::numeric_limits<double>::infinity() : arena.distance[slot];
+    }
+
+    // Fills ids from the inserted state to the target, returns false if the target was not reached.
+    bool path(Id target, std::vector<Id>& ids) const {
+        ids.clear();
+        Slot target_slot = arena.find(target);
+        if (target_slot == SearchArena::no_slot || std::isinf(arena.distance[target_slot])) {
+            return false;
+        }
+
+        size_t length = 0;
+        for (Slot current = target_slot; current != SearchArena::no_slot; current = arena.origin[current]) {
+            ++length;
+        }
+        ids.resize(length);
+        for (Slot current = target_slot; current != SearchArena::no_slot; current = arena.origin[current]) {
+            ids[--length] = arena.ids[current];
+        }
+        return true;
+    }
+
+    bool empty() const {
+        return arena.open_set.empty();
+    }
+
+    void insert(Id id) {
+        Slot slot = arena.add(id);
+        if (slot != SearchArena::no_slot) {
+            arena.distance[slot] = 0.0;
+            arena.open_set.push(slot, inflation * heuristic(id));
+        }
+    }
+
+    Lattice lattice;
+    CollisionTester tester;
+    Heuristic heuristic;
+    const PrimitiveTable& table;
+    SearchArena& arena;
+    double inflation = 1.0;
+};
+
+// Lifelong Planning A* between fixed initial and target states. Distances survive scene
+// updates: only states reached by primitives checking cells whose obstacle distance changed
+// are repaired, and the search continues from there instead of starting over.
+// The heuristic is euclidean, since it has to stay valid between scenes.
+struct IncrementalStateSpace {
+    using Id = Lattice::Id;
+    using Key = std::pair<double, double>;
+
+    IncrementalStateSpace(const PrimitiveTable& table) : table{table} {
+    }
+
+    // Unlike the arena, storage is kept for every state of the lattice.
+    static size_t required_memory(const Lattice& lattice) {
+        return lattice.size() * (sizeof(double) * 3 + sizeof(uint32_t));
+    }
+
+    // Starts a new search, reusing the storage of the previous one.
+    void reset(
+        Lattice new_lattice,
+        CollisionTester new_tester,
+        const DistanceField& field,
+        double scale,
+        Id new_initial,
+        Id new_target
+    ) {
+        lattice = new_lattice;
+        tester = new_tester;
+        obstacle_distance = field.distance;
+        initial = new_initial;
+        target = new_target;
+        heuristic = Heuristic::euclidean(lattice, lattice.cell(target), scale);
+        distance.assign(lattice.size(), std::numeric_limits<double>::infinity());
+        lookahead.assign(lattice.size(), std::numeric_limits<double>::infinity());
+        open_set.reset(lattice.size());
+        lookahead[initial] = 0.0;
+        open_set.push(initial, key(initial));
+        initialized = true;
+    }
+
+    void invalidate() {
+        initialized = false;
+    }
+
+    size_t open_size() const {
+        return open_set.size();
+    }
+
+    // Whether the search can be continued for a scene over the lattice between the states.
+    bool reusable(Lattice other, Id other_initial, Id other_target) const {
+        return initialized && lattice.matches(other) && initial == other_initial && target == other_target;
+    }
+
+    // Returns false without touching the search if the scene changed too much to be worth repairing.
+    bool update_scene(CollisionTester new_tester, const DistanceField& field) {
+        // Checks only compare distances against clearances, so changes beyond the largest one don't matter.
+        auto changed = [&](size_t i) {
+            float old_distance = obstacle_distance[i];
+            float new_distance = field.distance[i];
+            return old_distance != new_distance && std::min(old_distance, new_distance) < table.max_clearance;
+        };
+
+        if (obstacle_distance.size() != field.distance.size()) {
+            return false;
+        }
+        size_t changed_cells = 0;
+        for (size_t i = 0; i < obstacle_distance.size(); ++i) {
+            changed_cells += changed(i);
+        }
+        if (changed_cells * max_changed_fraction > obstacle_distance.size()) {
+            return false;
+        }
+
+        tester = new_tester;
+        for (int y = 0; y < lattice.height; ++y) {
+            for (int x = 0; x < lattice.width; ++x) {
+                if (changed(field.index(x, y))) {
+                    update_checking(Cell{x, y, 0});
+                }
+            }
+        }
+        obstacle_distance = field.distance;
+        return true;
+    }
+
+    // Fills ids from initial to target state, returns false if the target is unreachable.
+    // Search may be interrupted by the predicate and resumed later with another call.
+    template <typename Interrupted>
+    bool plan(Interrupted interrupted, std::vector<Id>& path) {
+        path.clear();
+        size_t expansions = 0;
+        while (!open_set.empty() &&
+               (open_set.top_priority() < key(target) || lookahead[target] != distance[target])) {
+            if (interrupted(++expansions)) {
+                return false;
+            }
+            Id optimal = open_set.top();
+            open_set.pop();
+
+            Cell cell = lattice.cell(optimal);
+            if (distance[optimal] > lookahead[optimal]) {
+                distance[optimal] = lookahead[optimal];
+            } else {
+                distance[optimal] = std::numeric_limits<double>::infinity();
+                update(optimal);
+            }
+            for (const PrimitiveTable::Entry* entry = table.begin(cell.theta); entry != table.end(cell.theta); ++entry) {
+                Cell next{cell.x + entry->end.dx, cell.y + entry->end.dy, entry->theta};
+                if (lattice.contains(next.x, next.y)) {
+                    update(lattice.index(next));
+                }
+            }
+        }
+
+        if (std::isinf(distance[target])) {
+            return false;
+        }
+
+        path.push_back(target);
+        while (path.back() != initial && path.size() <= lattice.size()) {
+            Id current = path.back();
+            Id best = current;
+            double best_distance = std::numeric_limits<double>::infinity();
+            for_each_incoming(current, [&](Id previous, double weight) {
+                if (distance[previous] + weight < best_distance) {
+                    best_distance = distance[previous] + weight;
+                    best = previous;
+                }
+            });
+            if (best == current) {
+                path.clear();
+                return false;
+            }
+            path.push_back(best);
+        }
+        std::reverse(path.begin(), path.end());
+        return true;
+    }
+
+private:
+    // Repair is abandoned when more than 1 / max_changed_fraction of the cells changed.
+    static constexpr size_t max_changed_fraction = 8;
+
+    Key key(Id id) const {
+        double value = std::min(distance[id], lookahead[id]);
+        return Key{value + heuristic(id), value};
+    }
+
+    // Calls visitor(previous, weight) for every collision-free primitive ending in the state.
+    template <typename Visitor>
+    void for_each_incoming(Id id, Visitor visitor) {
+        Cell cell = lattice.cell(id);
+        for (uint32_t i = table.incoming_begin[cell.theta]; i < table.incoming_begin[cell.theta + 1]; ++i) {
+            const PrimitiveTable::Entry& entry = table.entries[table.incoming[i]];
+            Cell previous{cell.x - entry.end.dx, cell.y - entry.end.dy, table.start_heading(table.incoming[i])};
+            if (lattice.contains(previous.x, previous.y) && !tester->test(previous, table, entry)) {
+                visitor(lattice.index(previous), entry.weight);
+            }
+        }
+    }
+
+    void update(Id id) {
+        if (id != initial) {
+            double best = std::numeric_limits<double>::infinity();
+            for_each_incoming(id, [&](Id previous, double weight) {
+                best = std::min(best, distance[previous] + weight);
+            });
+            lookahead[id] = best;
+        }
+
+        if (open_set.contains(id)) {
+            open_set.erase(id);
+        }
+        if (distance[id] != lookahead[id]) {
+            open_set.push(id, key(id));
+        }
+    }
+
+    // Updates every state whose incoming primitive checks the grid cell.
+    void update_checking(Cell cell) {
+        for (uint32_t i = 0; i < table.entries.size(); ++i) {
+            const PrimitiveTable::Entry& entry = table.entries[i];
+            for (uint32_t j = entry.checks_begin; j < entry.checks_end; ++j) {
+                Cell next{
+                    cell.x - table.checks[j].offset.dx + entry.end.dx,
+                    cell.y - table.checks[j].offset.dy + entry.end.dy,
+                    entry.theta,
+                };
+                if (lattice.contains(next.x, next.y)) {
+                    update(lattice.index(next));
+                }
+            }
+        }
+    }
+
+    const PrimitiveTable& table;
+    bool initialized = false;
+    Lattice lattice;
+    std::optional<CollisionTester> tester;
+    std::vector<float> obstacle_distance;
+    Heuristic heuristic;
+    Id initial = 0;
+    Id target = 0;
+    IndexedHeap<Key> open_set;
+    std::vector<double> distance;
+    std::vector<double> lookahead;
+};
+
+// Hash of everything the lattice and collision checks are built from. Cells are hashed in
+// blocks, so a patched grid only rehashes the blocks holding its changes.
+struct SceneHash {
+    static constexpr size_t block = 1 << 14;
+
+    void build(const GridInfo& info, const std::vector<int8_t>& cells) {
+        const double geometry[] = {
+            static_cast<double>(info.width),
+            static_cast<double>(info.height),
+            info.resolution,
+            info.origin_x,
+            info.origin_y,
+        };
+        seed = content_hash(geometry, sizeof(geometry));
+        blocks.resize((cells.size() + block - 1) / block);
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            hash_block(cells, i);
+        }
+        combine();
+    }
+
+    // Cells must keep the geometry they were built for.
+    void update(const GridInfo& info, const std::vector<int8_t>& cells, const GridRegion& changed) {
+        if (changed.empty()) {
+            return;
+        }
+        size_t begin = static_cast<size_t>(changed.y0) * info.width + changed.x0;
+        size_t end = static_cast<size_t>(changed.y1) * info.width + changed.x1;
+        for (size_t i = begin / block; i <= end / block; ++i) {
+            hash_block(cells, i);
+        }
+        combine();
+    }
+
+    uint64_t value = 0;
+
+private:
+    void hash_block(const std::vector<int8_t>& cells, size_t i) {
+        size_t begin = i * block;
+        blocks[i] = content_hash(cells.data() + begin, std::min(block, cells.size() - begin), i);
+    }
+
+    void combine() {
+        value = content_hash(blocks.data(), blocks.size() * sizeof(uint64_t), seed);
+    }
+
+    uint64_t seed = 0;
+    std::vector<uint64_t> blocks;
+};
+
+// Plans depend on the scene and the quantized states only, the configuration being fixed.
+struct PlanKey {
+    uint64_t scene;
+    Lattice::Id initial;
+    Lattice::Id target;
+
+    bool operator==(const PlanKey& other) const {
+        return scene == other.scene && initial == other.initial && target == other.target;
+    }
+
+    struct Hash {
+        size_t operator()(const PlanKey& key) const {
+            return key.scene ^ ((static_cast<uint64_t>(key.initial) << 32 | key.target) * 0x9E3779B97F4A7C15);
+        }
+    };
+};
+
+using PlanCache = LruCache<PlanKey, std::vector<Lattice::Id>, PlanKey::Hash>;
+
+}
+
+namespace planning_core {
+
+struct Planner::Impl {
+    explicit Impl(const json& config) : incremental(table) {
+        headings = config["lattice"]["headings"];
+        mode = search_mode_from_json(config["mode"]);
+        heuristic_type = heuristic_type_from_json(config["heuristic"]);
+        anytime = AnytimeParameters::from_json(config["anytime"]);
+        revalidation = RevalidationParameters::from_json(config["revalidation"]);
+        for (auto json_primitive : config["primitives"]) {
+            primitives.push_back(MotionPrimitive::from_json(json_primitive));
+        }
+        footprint = Footprint::from_json(config["footprint"]);
+        table = PrimitiveTable::build(primitives, footprint, headings, config["lattice"]["resolution"]);
+        scale = heuristic_scale(table);
+        octile_scale = heuristic_scale(table, true);
+        memory_limit = config["lattice"]["memory_limit_mb"].get<size_t>() << 20;
+        cache = PlanCache(config["cache"]["capacity"].get<size_t>());
+    }
+
+    bool set_scene(const GridInfo& new_info, const int8_t* new_cells) {
+        info = new_info;
+        cells.assign(new_cells, new_cells + static_cast<size_t>(info.width) * info.height);
+        scene_hash.build(info, cells);
+        scene_patchable = false;
+        scene_prepared = false;
+
+        if (table.resolution == info.resolution) {
+            return false;
+        }
+        table = PrimitiveTable::build(primitives, footprint, headings, info.resolution);
+        scale = heuristic_scale(table);
+        octile_scale = heuristic_scale(table, true);
+        incremental.invalidate();
+        return true;
+    }
+
+    // Cells written in place are prepared again on the next cache miss, near the changes only.
+    void changed(const GridRegion& region) {
+        if (region.empty()) {
+            return;
+        }
+        scene_hash.update(info, cells, region);
+        unprepared_changes.add(region);
+        scene_prepared = false;
+    }
+
+    // Scene is converted for collision checks on the first cache miss only.
+    CollisionTester prepare_scene(Lattice lattice, PlanResult& result) {
+        if (!scene_prepared) {
+            if (scene_patchable) {
+                const GridRegion& region = unprepared_changes;
+                occupancy.update(cells.data(), region.x0, region.y0, region.x1, region.y1);
+                field.update(occupancy, lattice.resolution, region);
+            } else {
+                occupancy.build(cells.data(), lattice.width, lattice.height);
+                field.build(occupancy, lattice.resolution, table.padding, table.max_clearance);
+                if (table.stride != field.stride) {
+                    table.index(field.stride);
+                }
+            }
+            unprepared_changes = GridRegion{};
+            scene_patchable = true;
+            result.computed_tiles = field.computed_tiles;
+            result.total_tiles = field.total_tiles;
+            scene_prepared = true;
+        }
+        CollisionTester tester{occupancy.grid(), field};
+        // Counter outlives the plan, since incremental search keeps the tester between plans.
+        tester.count_checks(collecting ? &stats.collision_checks : nullptr);
+        return tester;
+    }
+
+    PlanResult plan(State initial, State target, const Preempted& new_preempted, const Progress& new_progress) {
+        PlanResult result;
+        stats = PlanStats{};
+        Lattice lattice = Lattice::from_grid(info, headings);
+        if (lattice.size() > std::numeric_limits<Lattice::Id>::max()) {
+            result.status = PlanStatus::TooManyStates;
+            return result;
+        }
+
+        std::optional<Cell> initial_cell = lattice.quantize(initial);
+        std::optional<Cell> target_cell = lattice.quantize(target);
+        if (!initial_cell.has_value() || !target_cell.has_value()) {
+            result.status = PlanStatus::OutsideScene;
+            return result;
+        }
+        Lattice::Id initial_id = lattice.index(*initial_cell);
+        Lattice::Id target_id = lattice.index(*target_cell);
+
+        if (mode == SearchMode::Incremental && IncrementalStateSpace::required_memory(lattice) > memory_limit) {
+            result.status = PlanStatus::OutOfMemory;
+            return result;
+        }
+
+        PlanKey key{scene_hash.value, initial_id, target_id};
+        if (const std::vector<Lattice::Id>* cached = cache.find(key)) {
+            ++counters.cache_hits;
+            result.cache_hit = true;
+            remember(lattice, target, *cached);
+            return finish(lattice, *cached, result);
+        }
+        ++counters.cache_misses;
+
+        CollisionTester tester = prepare_scene(lattice, result);
+        if (revalidation.enabled && last_path_valid(lattice, tester, initial_id, *target_cell, target)) {
+            ++counters.bypassed_plans;
+            result.bypassed = true;
+            // The key is for the new target, the path ends at it only if it stayed in its cell.
+            if (last_path.back() == target_id) {
+                cache.insert(key, last_path);
+            }
+            return finish(lattice, last_path, result);
+        }
+        ++counters.searched_plans;
+
+        preempted = &new_preempted;
+        progress = &new_progress;
+        stale = false;
+        expired = false;
+        expansions = 0;
+        closed_since = 0;
+        bool found = false;
+        if (mode == SearchMode::Anytime) {
+            found = plan_anytime(lattice, tester, initial_id, target_id);
+            result.reported = static_cast<bool>(*progress);
+        } else if (mode == SearchMode::Incremental) {
+            found = plan_incremental(lattice, tester, initial_id, target_id);
+        } else {
+            found = plan_astar(lattice, tester, initial_id, target_id);
+        }
+        result.overflow = arena.overflow;
+        result.expansions = expansions;
+        result.stats = stats;
+
+        if (stale) {
+            ++counters.preempted_plans;
+            result.status = PlanStatus::Preempted;
+            return result;
+        }
+        if (!found) {
+            arena.path.clear();
+        }
+        // A search cut short by the deadline or the memory limit may have missed a path.
+        if (found || (!arena.overflow && !expired)) {
+            cache.insert(key, arena.path);
+        }
+        remember(lattice, target, arena.path);
+        return finish(lattice, arena.path, result);
+    }
+
+    PlanResult& finish(Lattice lattice, const std::vector<Lattice::Id>& ids, PlanResult& result) const {
+        result.stats.collision_checks = stats.collision_checks;
+        result.status = ids.empty() ? PlanStatus::NotFound : PlanStatus::Found;
+        result.path = to_poses(lattice, ids);
+        return result;
+    }
+
+    static std::vector<Pose> to_poses(Lattice lattice, const std::vector<Lattice::Id>& ids) {
+        std::vector<Pose> poses(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            poses[i] = lattice.center(lattice.cell(ids[i])).to_pose();
+        }
+        return poses;
+    }
+
+    // Last path leads from the initial state, ends with the target heading close enough to the
+    // target and the footprint can still follow it in the scene.
+    bool last_path_valid(
+        Lattice lattice, CollisionTester tester, Lattice::Id initial_id, Cell target_cell, State target
+    ) const {
+        return !last_path.empty() && last_lattice.matches(lattice) && last_path.front() == initial_id &&
+            lattice.cell(last_path.back()).theta == target_cell.theta &&
+            std::hypot(target.x - last_target.x, target.y - last_target.y) <= revalidation.target_tolerance &&
+            path_clear(lattice, tester, table, last_path);
+    }
+
+    void remember(Lattice lattice, State target, const std::vector<Lattice::Id>& path) {
+        last_lattice = lattice;
+        last_target = target;
+        last_path = path;
+    }
+
+    // Polled by searches every expansion, asks the caller every few: a plan on data the caller
+    // already has newer versions of is dropped, so planning restarts on fresh data.
+    bool interrupted(size_t expansion) {
+        static constexpr size_t preemption_check_period = 64;
+
+        expansions = expansion;
+        if (collecting) {
+            size_t open_size = mode == SearchMode::Incremental ? incremental.open_size() : arena.open_set.size();
+            stats.open_peak = std::max(stats.open_peak, open_size);
+            stats.closed_peak = std::max(stats.closed_peak, expansion - 1 - closed_since);
+        }
+        if (!stale && expansion % preemption_check_period == 0 && *preempted) {
+            stale = (*preempted)();
+        }
+        return stale;
+    }
+
+    void report(Lattice lattice, const std::vector<Lattice::Id>& ids) const {
+        if (*progress) {
+            (*progress)(to_poses(lattice, ids));
+        }
+    }
+
+    Heuristic make_heuristic(Lattice lattice, Lattice::Id target_id) {
+        if (heuristic_type == HeuristicType::Grid) {
+            return Heuristic::grid(
+                lattice, occupancy, lattice.cell(target_id), scale, octile_scale, arena.heuristic, arena.heuristic_queue
+            );
+        } else if (heuristic_type == HeuristicType::Euclidean) {
+            return Heuristic::euclidean(lattice, lattice.cell(target_id), scale);
+        }
+        return Heuristic::none();
+    }
+
+    // Fills arena.path, returns false if no path was found.
+    bool plan_astar(Lattice lattice, CollisionTester tester, Lattice::Id initial_id, Lattice::Id target_id) {
+        arena.reset(memory_limit / SearchArena::state_memory);
+        StateSpace state_space(lattice, tester, make_heuristic(lattice, target_id), table, arena);
+        state_space.insert(initial_id);
+
+        size_t expansion = 0;
+        while (!state_space.empty() && !arena.overflow && !interrupted(++expansion)) {
+            if (state_space.get_optimal() == target_id) {
+                return state_space.path(target_id, arena.path);
+            }
+
+            state_space.expand_optimal();
+        }
+        return false;
+    }
+
+    // Anytime Repairing A*: the first path comes quickly from an inflated heuristic, then the
+    // inflation is lowered step by step reusing the previous search effort. Every improved path
+    // is reported right away, planning stops at the deadline or once the path is optimal.
+    // Leaves the last reported path in arena.path, returns false if none was found.
+    bool plan_anytime(Lattice lattice, CollisionTester tester, Lattice::Id initial_id, Lattice::Id target_id) {
+        static constexpr size_t deadline_check_period = 64;
+
+        auto deadline = std::chrono::steady_clock::now() + anytime.deadline;
+        arena.reset(memory_limit / SearchArena::state_memory);
+        StateSpace state_space(lattice, tester, make_heuristic(lattice, target_id), table, arena);
+        state_space.inflation = std::max(1.0, anytime.initial_inflation);
+        state_space.insert(initial_id);
+
+        double reported_distance = std::numeric_limits<double>::infinity();
+        size_t expansion = 0;
+        while (!expired) {
+            while (!state_space.empty() && !arena.overflow &&
+                   arena.open_set.top_priority() < state_space.distance(target_id)) {
+                if (++expansion % deadline_check_period == 0 && std::chrono::steady_clock::now() >= deadline) {
+                    expired = true;
+                    break;
+                }
+                if (interrupted(expansion)) {
+                    return false;
+                }
+                state_space.expand_optimal();
+            }
+
+            if (state_space.distance(target_id) < reported_distance) {
+                reported_distance = state_space.distance(target_id);
+                state_space.path(target_id, arena.path);
+                report(lattice, arena.path);
+            }
+            if (state_space.inflation <= 1.0 || arena.overflow || std::chrono::steady_clock::now() >= deadline) {
+                break;
+            }
+            state_space.restart(std::max(1.0, state_space.inflation - anytime.inflation_step));
+            closed_since = expansion;
+        }
+
+        if (std::isinf(reported_distance)) {
+            report(lattice, {});
+            return false;
+        }
+        return true;
+    }
+
+    // Fills arena.path, returns false if no path was found.
+    bool plan_incremental(Lattice lattice, CollisionTester tester, Lattice::Id initial_id, Lattice::Id target_id) {
+        bool updated = incremental.reusable(lattice, initial_id, target_id) &&
+            incremental.update_scene(tester, field);
+        if (!updated) {
+            incremental.reset(lattice, tester, field, scale, initial_id, target_id);
+        }
+        return incremental.plan(
+            [this](size_t expansion) {
+                return interrupted(expansion);
+            },
+            arena.path
+        );
+    }
+
+    MotionPrimitives primitives;
+    Footprint footprint;
+    PrimitiveTable table;
+    int headings;
+    SearchMode mode;
+    HeuristicType heuristic_type;
+    AnytimeParameters anytime;
+    RevalidationParameters revalidation;
+    double scale;
+    double octile_scale;
+    size_t memory_limit;
+
+    OccupancyPyramid occupancy;
+    DistanceField field;
+    SearchArena arena;
+    IncrementalStateSpace incremental;
+
+    // Callbacks of the plan in progress.
+    const Preempted* preempted = nullptr;
+    const Progress* progress = nullptr;
+    bool stale = false;
+    // Anytime search stopped at the deadline with states left to expand.
+    bool expired = false;
+    size_t expansions = 0;
+    // Expansion the closed set was last emptied at, anytime search empties it on every restart.
+    size_t closed_since = 0;
+
+    bool collecting = false;
+    PlanStats stats;
+
+    PlanCache cache;
+    PlanCounters counters;
+    GridInfo info;
+    std::vector<int8_t> cells;
+    SceneHash scene_hash;
+    // Pyramid and field are up to date but for the unprepared changes, or describe another grid.
+    bool scene_patchable = false;
+    GridRegion unprepared_changes;
+    bool scene_prepared = false;
+
+    Lattice last_lattice{};
+    State last_target{};
+    std::vector<Lattice::Id> last_path;
+};
+
+Planner::Planner(const nlohmann::json& config) : impl(std::make_unique<Impl>(config)) {
+}
+
+Planner::~Planner() = default;
+
+bool Planner::set_scene(const GridInfo& info, const int8_t* cells) {
+    return impl->set_scene(info, cells);
+}
+
+int8_t* Planner::cells() {
+    return impl->cells.data();
+}
+
+const GridInfo& Planner::scene() const {
+    return impl->info;
+}
+
+void Planner::changed(const GridRegion& region) {
+    impl->changed(region);
+}
+
+PlanResult Planner::plan(Pose initial, Pose target, const Preempted& preempted, const Progress& progress) {
+    return impl->plan(State::from_pose(initial), State::from_pose(target), preempted, progress);
+}
+
+void Planner::collect_stats(bool enabled) {
+    impl->collecting = enabled;
+}
+
+const PlanCounters& Planner::counters() const {
+    return impl->counters;
+}
+
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+// Search and collision checking over occupancy grids, free of ROS so it can be benchmarked
+// and driven by tools on its own. The node feeds it scenes and targets from topics.
+namespace planning_core {
+
+// Inclusive rectangle of grid cells, empty until a cell is added.
+struct GridRegion {
+    int x0 = 0;
+    int y0 = 0;
+    int x1 = -1;
+    int y1 = -1;
+
+    bool empty() const {
+        return x0 > x1 || y0 > y1;
+    }
+
+    void add(int x, int y) {
+        add(GridRegion{x, y, x, y});
+    }
+
+    void add(const GridRegion& other) {
+        if (other.empty()) {
+            return;
+        }
+        if (empty()) {
+            *this = other;
+            return;
+        }
+        x0 = std::min(x0, other.x0);
+        y0 = std::min(y0, other.y0);
+        x1 = std::max(x1, other.x1);
+        y1 = std::max(y1, other.y1);
+    }
+};
+
+// Occupancy grid placement, cells are stored row by row starting from the origin corner.
+struct GridInfo {
+    int width = 0;
+    int height = 0;
+    double resolution = 0.0;
+    double origin_x = 0.0;
+    double origin_y = 0.0;
+};
+
+// Position in meters and heading in radians in the grid frame.
+struct Pose {
+    double x = 0.0;
+    double y = 0.0;
+    double theta = 0.0;
+};
+
+enum class PlanStatus {
+    Found,
+    NotFound,
+    // Gave up because the preemption predicate returned true, the path is empty.
+    Preempted,
+    TooManyStates,
+    OutsideScene,
+    OutOfMemory,
+};
+
+// Search effort, zero unless collected, see Planner::collect_stats.
+struct PlanStats {
+    // Largest open and closed sets, sampled before every expansion. Closed states of anytime
+    // search are counted per inflation, those of incremental search are the states made consistent.
+    size_t open_peak = 0;
+    size_t closed_peak = 0;
+    // Footprint clearance lookups, including the revalidation of the last path.
+    uint64_t collision_checks = 0;
+};
+
+struct PlanResult {
+    PlanStatus status = PlanStatus::NotFound;
+    // Lattice cell centers from the initial to the target pose, empty unless found.
+    std::vector<Pose> path;
+    bool cache_hit = false;
+    // Last path was still clear and returned without a search.
+    bool bypassed = false;
+    // Search stopped at the memory limit.
+    bool overflow = false;
+    // Anytime search already reported the path through the progress callback.
+    bool reported = false;
+    size_t expansions = 0;
+    // Distance field tiles computed when the scene was prepared by this plan, zero otherwise.
+    size_t computed_tiles = 0;
+    size_t total_tiles = 0;
+    PlanStats stats;
+};
+
+// Totals over the planner lifetime.
+struct PlanCounters {
+    size_t cache_hits = 0;
+    size_t cache_misses = 0;
+    size_t bypassed_plans = 0;
+    size_t searched_plans = 0;
+    size_t preempted_plans = 0;
+};
+
+// Keeps the scene, the search storage and the plan cache between plans. Not thread safe.
+class Planner {
+public:
+    // Polled every few expansions, planning gives up once it returns true.
+    using Preempted = std::function<bool()>;
+    // Called by anytime search with every improved path, and with an empty one if none was found.
+    using Progress = std::function<void(const std::vector<Pose>&)>;
+
+    // Takes the planner section of the node configuration, see config.json.
+    explicit Planner(const nlohmann::json& config);
+    ~Planner();
+
+    Planner(const Planner&) = delete;
+    Planner& operator=(const Planner&) = delete;
+
+    // Replaces the scene with a copy of the cells. Returns true if the resolution changed and
+    // the motion primitives were rebuilt for it.
+    bool set_scene(const GridInfo& info, const int8_t* cells);
+
+    // Cells of the current scene, writable in place as long as every write is reported to changed.
+    int8_t* cells();
+    const GridInfo& scene() const;
+    void changed(const GridRegion& region);
+
+    PlanResult plan(Pose initial, Pose target, const Preempted& preempted = {}, const Progress& progress = {});
+
+    // Off by default, collecting adds a few branches per expansion and per collision query.
+    void collect_stats(bool enabled);
+
+    const PlanCounters& counters() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+}
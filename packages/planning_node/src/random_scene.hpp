@@ -0,0 +1,51 @@
+#pragma once
+#include "planner_core.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+
+namespace planning_core {
+
+struct RandomScene {
+    GridInfo info;
+    std::vector<int8_t> cells;
+};
+
+// Same random scene the unwrapping node publishes, square with the origin in its center cell.
+// Cells around the start at the origin and around the target are cleared, so most scenes have
+// a path to search for. Shared by the planner benchmark and the simulator.
+inline RandomScene make_random_scene(
+    std::mt19937_64& engine, double radius, double probability, double resolution, Pose target
+) {
+    int dx = static_cast<int>(std::lround(radius / resolution));
+    RandomScene scene;
+    scene.info = GridInfo{2 * dx + 1, 2 * dx + 1, resolution, -(dx + 0.5) * resolution, -(dx + 0.5) * resolution};
+
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    scene.cells.resize(static_cast<size_t>(scene.info.width) * scene.info.height);
+    for (int8_t& cell : scene.cells) {
+        cell = distribution(engine) < probability ? 100 : 0;
+    }
+
+    auto clear = [&](Pose pose) {
+        const double clearance = 1.5;
+        for (int y = 0; y < scene.info.height; ++y) {
+            for (int x = 0; x < scene.info.width; ++x) {
+                double cx = scene.info.origin_x + (x + 0.5) * resolution;
+                double cy = scene.info.origin_y + (y + 0.5) * resolution;
+                if (std::hypot(cx - pose.x, cy - pose.y) <= clearance) {
+                    scene.cells[static_cast<size_t>(y) * scene.info.width + x] = 0;
+                }
+            }
+        }
+    };
+    clear(Pose{});
+    clear(target);
+    return scene;
+}
+
+}
@@ -0,0 +1,216 @@
+#include "planner_core.hpp"
+#include "scenario_log.hpp"
+
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Replays a scenario log recorded by the planning node through the planner core on every core,
+// prints latency percentiles and lists plans whose path got longer than the recorded one.
+//
+//   replay <scenario log> <config.json> [--threads N] [--tolerance FRACTION] [--repeat N]
+
+namespace {
+
+using planning_core::PlanStatus;
+using planning_core::Pose;
+using planning_core::Scenario;
+using planning_core::ScenarioReader;
+
+struct Options {
+    std::string log_path;
+    std::string config_path;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    // Replayed path may be this fraction longer than the recorded one before it's a regression.
+    double tolerance = 0.01;
+    size_t repeat = 1;
+};
+
+struct Replayed {
+    double latency_us = 0.0;
+    PlanStatus status = PlanStatus::NotFound;
+    double length = 0.0;
+};
+
+double path_length(const std::vector<Pose>& path) {
+    double length = 0.0;
+    for (size_t i = 1; i < path.size(); ++i) {
+        length += std::hypot(path[i].x - path[i - 1].x, path[i].y - path[i - 1].y);
+    }
+    return length;
+}
+
+void usage() {
+    std::fprintf(
+        stderr, "usage: replay <scenario log> <config.json> [--threads N] [--tolerance FRACTION] [--repeat N]\n"
+    );
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            positional.push_back(arg);
+            continue;
+        }
+        if (i + 1 == argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--threads") {
+            options.threads = std::max(1ul, std::stoul(value));
+        } else if (arg == "--tolerance") {
+            options.tolerance = std::stod(value);
+        } else if (arg == "--repeat") {
+            options.repeat = std::max(1ul, std::stoul(value));
+        } else {
+            return false;
+        }
+    }
+    if (positional.size() != 2) {
+        return false;
+    }
+    options.log_path = positional[0];
+    options.config_path = positional[1];
+    return true;
+}
+
+// Value below which the given fraction of the sorted values lies.
+double percentile(const std::vector<double>& sorted, double fraction) {
+    return sorted[static_cast<size_t>(fraction * (sorted.size() - 1))];
+}
+
+void print_distribution(const char* name, std::vector<double> latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    std::printf(
+        "%-8s p50 %9.1f us  p90 %9.1f us  p99 %9.1f us  max %9.1f us\n", name, percentile(latencies, 0.5),
+        percentile(latencies, 0.9), percentile(latencies, 0.99), latencies.back()
+    );
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        if (!parse_options(argc, argv, options)) {
+            usage();
+            return 2;
+        }
+    } catch (const std::exception&) {
+        usage();
+        return 2;
+    }
+
+    try {
+        ScenarioReader log{options.log_path};
+        if (log.size() == 0) {
+            std::printf("%s has no scenarios\n", options.log_path.c_str());
+            return 0;
+        }
+
+        std::ifstream config_stream(options.config_path);
+        nlohmann::json config = nlohmann::json::parse(config_stream);
+        // Every scenario is searched, the cache and revalidation depend on what the worker saw before.
+        config["cache"]["capacity"] = 0;
+        config["revalidation"]["enabled"] = false;
+
+        // Workers take scenarios in batches from a shared counter, each with a planner of its own.
+        size_t total = log.size() * options.repeat;
+        const size_t batch = 16;
+        std::vector<Replayed> replayed(total);
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        std::string error;
+        auto worker = [&]() {
+            try {
+                planning_core::Planner planner{config};
+                size_t begin;
+                while ((begin = next.fetch_add(batch)) < total && !failed) {
+                    for (size_t i = begin; i < std::min(begin + batch, total); ++i) {
+                        Scenario scenario = log.get(i % log.size());
+                        auto start = std::chrono::steady_clock::now();
+                        planner.set_scene(scenario.scene, scenario.cells);
+                        planning_core::PlanResult result = planner.plan(scenario.initial, scenario.target);
+                        std::chrono::duration<double, std::micro> latency = std::chrono::steady_clock::now() - start;
+                        replayed[i] = Replayed{latency.count(), result.status, path_length(result.path)};
+                    }
+                }
+            } catch (const std::exception& e) {
+                if (!failed.exchange(true)) {
+                    error = e.what();
+                }
+            }
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < options.threads; ++i) {
+            workers.emplace_back(worker);
+        }
+        for (std::thread& thread : workers) {
+            thread.join();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (failed) {
+            std::fprintf(stderr, "replay failed: %s\n", error.c_str());
+            return 2;
+        }
+
+        std::vector<double> recorded_latencies;
+        std::vector<double> replayed_latencies;
+        size_t found = 0;
+        size_t improved = 0;
+        size_t regressions = 0;
+        for (size_t i = 0; i < total; ++i) {
+            replayed_latencies.push_back(replayed[i].latency_us);
+            found += replayed[i].status == PlanStatus::Found;
+            if (i >= log.size()) {
+                continue;
+            }
+
+            Scenario scenario = log.get(i);
+            recorded_latencies.push_back(scenario.latency_us);
+            if (scenario.status != PlanStatus::Found) {
+                improved += replayed[i].status == PlanStatus::Found;
+                continue;
+            }
+            double recorded = path_length(scenario.path);
+            if (replayed[i].status != PlanStatus::Found) {
+                ++regressions;
+                std::printf("regression: scenario %zu found no path, recorded %.3f m\n", i, recorded);
+            } else if (replayed[i].length > recorded * (1.0 + options.tolerance) + 1e-9) {
+                ++regressions;
+                std::printf(
+                    "regression: scenario %zu path is %.3f m, recorded %.3f m\n", i, replayed[i].length, recorded
+                );
+            } else if (replayed[i].length < recorded * (1.0 - options.tolerance) - 1e-9) {
+                ++improved;
+            }
+        }
+
+        std::printf(
+            "%zu plans of %zu scenarios on %zu threads in %.2f s, %.1f plans/s\n", total, log.size(),
+            options.threads, elapsed.count(), total / elapsed.count()
+        );
+        std::printf("%zu of %zu plans found, %zu improved, %zu regressions\n", found, total, improved, regressions);
+        print_distribution("recorded", recorded_latencies);
+        print_distribution("replayed", replayed_latencies);
+        return regressions == 0 ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "replay failed: %s\n", e.what());
+        return 2;
+    }
+}
@@ -0,0 +1,269 @@
+#include "scenario_log.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <stdexcept>
+
+
+namespace planning_core {
+
+namespace {
+
+constexpr char header_magic[8] = {'T', 'R', 'K', 'S', 'C', 'E', 'N', 'E'};
+constexpr char trailer_magic[8] = {'T', 'R', 'K', 'I', 'N', 'D', 'E', 'X'};
+constexpr uint32_t version = 1;
+constexpr size_t header_size = 16;
+constexpr size_t chunk_header_size = 16;
+constexpr size_t trailer_size = 16;
+
+enum ChunkTag : uint32_t {
+    SceneChunk = 1,
+    PlanChunk = 2,
+    IndexChunk = 3,
+};
+
+// Chunks start at multiples of 8, so payloads keep the alignment of the mapping.
+uint64_t padded(uint64_t size) {
+    return (size + 7) & ~uint64_t{7};
+}
+
+template <typename T>
+void put(std::vector<char>& buffer, T value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+void put_pose(std::vector<char>& buffer, Pose pose) {
+    put(buffer, pose.x);
+    put(buffer, pose.y);
+    put(buffer, pose.theta);
+}
+
+// Reads fields in order from a bounded range of the mapping.
+struct Cursor {
+    const char* position;
+    const char* end;
+
+    template <typename T>
+    T get() {
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    Pose get_pose() {
+        Pose pose;
+        pose.x = get<double>();
+        pose.y = get<double>();
+        pose.theta = get<double>();
+        return pose;
+    }
+
+    const char* take(size_t size) {
+        if (static_cast<size_t>(end - position) < size) {
+            throw std::runtime_error("Scenario log chunk is truncated");
+        }
+        const char* result = position;
+        position += size;
+        return result;
+    }
+};
+
+}
+
+ScenarioWriter::ScenarioWriter(const std::string& path)
+    : stream(path, std::ios::binary | std::ios::trunc) {
+    if (!stream) {
+        throw std::runtime_error("Can't open scenario log " + path);
+    }
+    buffer.assign(header_magic, header_magic + sizeof(header_magic));
+    put(buffer, version);
+    put(buffer, uint32_t{0});
+    stream.write(buffer.data(), buffer.size());
+    offset = buffer.size();
+}
+
+ScenarioWriter::~ScenarioWriter() {
+    uint64_t index_offset = offset;
+    buffer.clear();
+    for (uint64_t plan_offset : plan_offsets) {
+        put(buffer, plan_offset);
+    }
+    write_chunk(IndexChunk, buffer);
+
+    buffer.clear();
+    put(buffer, index_offset);
+    buffer.insert(buffer.end(), trailer_magic, trailer_magic + sizeof(trailer_magic));
+    stream.write(buffer.data(), buffer.size());
+}
+
+void ScenarioWriter::write(
+    const GridInfo& scene, const int8_t* cells, Pose initial, Pose target, const PlanResult& result,
+    double latency_us
+) {
+    size_t cell_count = static_cast<size_t>(scene.width) * scene.height;
+    bool same_scene = has_scene && scene.width == last_scene.width && scene.height == last_scene.height &&
+        scene.resolution == last_scene.resolution && scene.origin_x == last_scene.origin_x &&
+        scene.origin_y == last_scene.origin_y && std::memcmp(cells, last_cells.data(), cell_count) == 0;
+    if (!same_scene) {
+        buffer.clear();
+        put(buffer, static_cast<int32_t>(scene.width));
+        put(buffer, static_cast<int32_t>(scene.height));
+        put(buffer, scene.resolution);
+        put(buffer, scene.origin_x);
+        put(buffer, scene.origin_y);
+        buffer.insert(buffer.end(), cells, cells + cell_count);
+
+        last_scene_offset = offset;
+        write_chunk(SceneChunk, buffer);
+        last_scene = scene;
+        last_cells.assign(cells, cells + cell_count);
+        has_scene = true;
+    }
+
+    buffer.clear();
+    put(buffer, last_scene_offset);
+    put_pose(buffer, initial);
+    put_pose(buffer, target);
+    put(buffer, static_cast<uint32_t>(result.status));
+    put(buffer, static_cast<uint32_t>(result.path.size()));
+    put(buffer, latency_us);
+    for (Pose pose : result.path) {
+        put_pose(buffer, pose);
+    }
+    plan_offsets.push_back(offset);
+    write_chunk(PlanChunk, buffer);
+}
+
+void ScenarioWriter::write_chunk(uint32_t tag, const std::vector<char>& payload) {
+    char chunk_header[chunk_header_size] = {};
+    uint64_t size = payload.size();
+    std::memcpy(chunk_header, &tag, sizeof(tag));
+    std::memcpy(chunk_header + 8, &size, sizeof(size));
+    stream.write(chunk_header, sizeof(chunk_header));
+    stream.write(payload.data(), payload.size());
+
+    const char padding[8] = {};
+    stream.write(padding, padded(size) - size);
+    offset += chunk_header_size + padded(size);
+}
+
+ScenarioReader::ScenarioReader(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Can't open scenario log " + path);
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < header_size) {
+        close(fd);
+        throw std::runtime_error("Scenario log " + path + " is too short");
+    }
+    length = static_cast<size_t>(status.st_size);
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Can't map scenario log " + path);
+    }
+    data = static_cast<const char*>(mapping);
+
+    uint32_t file_version;
+    std::memcpy(&file_version, data + sizeof(header_magic), sizeof(file_version));
+    if (std::memcmp(data, header_magic, sizeof(header_magic)) != 0 || file_version != version) {
+        munmap(const_cast<char*>(data), length);
+        throw std::runtime_error(path + " is not a version " + std::to_string(version) + " scenario log");
+    }
+
+    // Index written by the writer is used as is, a log without one is scanned.
+    if (length >= header_size + chunk_header_size + trailer_size &&
+        std::memcmp(data + length - sizeof(trailer_magic), trailer_magic, sizeof(trailer_magic)) == 0) {
+        uint64_t index_offset;
+        std::memcpy(&index_offset, data + length - trailer_size, sizeof(index_offset));
+        if (index_offset >= header_size && index_offset <= length - trailer_size - chunk_header_size) {
+            Cursor cursor{data + index_offset, data + length - trailer_size};
+            uint32_t tag = cursor.get<uint32_t>();
+            cursor.get<uint32_t>();
+            uint64_t size = cursor.get<uint64_t>();
+            if (tag == IndexChunk && size % sizeof(uint64_t) == 0 &&
+                size <= static_cast<uint64_t>(cursor.end - cursor.position)) {
+                plan_offsets.resize(size / sizeof(uint64_t));
+                std::memcpy(plan_offsets.data(), cursor.position, size);
+                return;
+            }
+        }
+    }
+    scan();
+}
+
+ScenarioReader::~ScenarioReader() {
+    munmap(const_cast<char*>(data), length);
+}
+
+void ScenarioReader::scan() {
+    uint64_t offset = header_size;
+    while (offset + chunk_header_size <= length) {
+        Cursor cursor{data + offset, data + length};
+        uint32_t tag = cursor.get<uint32_t>();
+        cursor.get<uint32_t>();
+        uint64_t size = cursor.get<uint64_t>();
+        if (size > length - offset - chunk_header_size || tag == IndexChunk) {
+            break;
+        }
+        if (tag == PlanChunk) {
+            plan_offsets.push_back(offset);
+        }
+        offset += chunk_header_size + padded(size);
+    }
+}
+
+Scenario ScenarioReader::get(size_t index) const {
+    auto chunk = [this](uint64_t offset, uint32_t expected) {
+        if (offset > length || length - offset < chunk_header_size) {
+            throw std::runtime_error("Scenario log chunk is out of the file");
+        }
+        Cursor cursor{data + offset, data + length};
+        uint32_t tag = cursor.get<uint32_t>();
+        cursor.get<uint32_t>();
+        uint64_t size = cursor.get<uint64_t>();
+        if (tag != expected || size > static_cast<uint64_t>(cursor.end - cursor.position)) {
+            throw std::runtime_error("Scenario log chunk is corrupt");
+        }
+        cursor.end = cursor.position + size;
+        return cursor;
+    };
+
+    Scenario scenario;
+    Cursor plan = chunk(plan_offsets.at(index), PlanChunk);
+    uint64_t scene_offset = plan.get<uint64_t>();
+    scenario.initial = plan.get_pose();
+    scenario.target = plan.get_pose();
+    scenario.status = static_cast<PlanStatus>(plan.get<uint32_t>());
+    uint32_t path_size = plan.get<uint32_t>();
+    scenario.latency_us = plan.get<double>();
+    if (path_size > static_cast<size_t>(plan.end - plan.position) / (3 * sizeof(double))) {
+        throw std::runtime_error("Scenario log path is truncated");
+    }
+    scenario.path.resize(path_size);
+    for (Pose& pose : scenario.path) {
+        pose = plan.get_pose();
+    }
+
+    Cursor scene = chunk(scene_offset, SceneChunk);
+    scenario.scene.width = scene.get<int32_t>();
+    scenario.scene.height = scene.get<int32_t>();
+    scenario.scene.resolution = scene.get<double>();
+    scenario.scene.origin_x = scene.get<double>();
+    scenario.scene.origin_y = scene.get<double>();
+    if (scenario.scene.width < 0 || scenario.scene.height < 0) {
+        throw std::runtime_error("Scenario log scene has a negative size");
+    }
+    scenario.cells = reinterpret_cast<const int8_t*>(
+        scene.take(static_cast<size_t>(scenario.scene.width) * scenario.scene.height)
+    );
+    return scenario;
+}
+
+}
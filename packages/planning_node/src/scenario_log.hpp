@@ -0,0 +1,85 @@
+#pragma once
+#include "planner_core.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+// Binary log of the scenes and targets the planner saw and the paths it returned, so recorded
+// drives can be replayed offline. The file is a header, a sequence of chunks, and an index of
+// the plan chunks followed by a trailer. Scenes are written once and shared by the plans made on
+// them. Numbers are stored little endian, as on every target of the truck.
+namespace planning_core {
+
+// One recorded plan. Cells point into the mapped log and stay valid while it's open.
+struct Scenario {
+    GridInfo scene;
+    const int8_t* cells = nullptr;
+    Pose initial;
+    Pose target;
+    PlanStatus status = PlanStatus::NotFound;
+    std::vector<Pose> path;
+    // Time the recording planner spent in Planner::plan.
+    double latency_us = 0.0;
+};
+
+class ScenarioWriter {
+public:
+    // Truncates the file. Throws std::runtime_error if it can't be opened.
+    explicit ScenarioWriter(const std::string& path);
+    // Writes the index, a log left without one is still readable by scanning its chunks.
+    ~ScenarioWriter();
+
+    ScenarioWriter(const ScenarioWriter&) = delete;
+    ScenarioWriter& operator=(const ScenarioWriter&) = delete;
+
+    // Scene is stored again only if it differs from the one of the previous record.
+    void write(
+        const GridInfo& scene, const int8_t* cells, Pose initial, Pose target, const PlanResult& result,
+        double latency_us
+    );
+
+private:
+    void write_chunk(uint32_t tag, const std::vector<char>& payload);
+
+    std::ofstream stream;
+    uint64_t offset = 0;
+
+    GridInfo last_scene;
+    std::vector<int8_t> last_cells;
+    uint64_t last_scene_offset = 0;
+    bool has_scene = false;
+
+    std::vector<uint64_t> plan_offsets;
+    std::vector<char> buffer;
+};
+
+// Memory maps a log, scenarios are decoded on demand and can be read from many threads at once.
+class ScenarioReader {
+public:
+    // Throws std::runtime_error if the file can't be mapped or isn't a scenario log.
+    explicit ScenarioReader(const std::string& path);
+    ~ScenarioReader();
+
+    ScenarioReader(const ScenarioReader&) = delete;
+    ScenarioReader& operator=(const ScenarioReader&) = delete;
+
+    size_t size() const {
+        return plan_offsets.size();
+    }
+
+    Scenario get(size_t index) const;
+
+private:
+    // Rebuilds the index of a log whose writer didn't finish, up to the last complete chunk.
+    void scan();
+
+    const char* data = nullptr;
+    size_t length = 0;
+    std::vector<uint64_t> plan_offsets;
+};
+
+}
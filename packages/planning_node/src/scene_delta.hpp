@@ -0,0 +1,61 @@
+#pragma once
+#include "planner_core.hpp"
+#include "planning_interfaces/msg/scene_delta.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+
+// Whether the delta is well formed and every cell it writes lies within a grid of the given size.
+inline bool delta_fits(const planning_interfaces::msg::SceneDelta& delta, size_t cells) {
+    if (delta.indices.size() != delta.values.size() || delta.run_starts.size() != delta.run_lengths.size() ||
+        delta.run_starts.size() != delta.run_values.size()) {
+        return false;
+    }
+    for (uint32_t index : delta.indices) {
+        if (index >= cells) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < delta.run_starts.size(); ++i) {
+        if (delta.run_starts[i] >= cells || delta.run_lengths[i] > cells - delta.run_starts[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Writes the delta into the cells of a grid of the given width in place and returns the cells
+// whose value changed. The delta must fit the grid, see delta_fits.
+inline planning_core::GridRegion apply_delta(
+    const planning_interfaces::msg::SceneDelta& delta, int8_t* cells, int width
+) {
+    planning_core::GridRegion changed;
+    auto add_index = [&](size_t index) {
+        changed.add(static_cast<int>(index % width), static_cast<int>(index / width));
+    };
+
+    for (size_t i = 0; i < delta.indices.size(); ++i) {
+        int8_t& cell = cells[delta.indices[i]];
+        if (cell != delta.values[i]) {
+            cell = delta.values[i];
+            add_index(delta.indices[i]);
+        }
+    }
+    for (size_t i = 0; i < delta.run_starts.size(); ++i) {
+        size_t begin = delta.run_starts[i];
+        size_t end = begin + delta.run_lengths[i];
+        if (begin == end) {
+            continue;
+        }
+        std::fill(cells + begin, cells + end, delta.run_values[i]);
+        // A run wrapping to the next row touches cells across the whole width.
+        add_index(begin);
+        add_index(end - 1);
+        if (begin / width != (end - 1) / width) {
+            changed.add(planning_core::GridRegion{0, changed.y0, width - 1, changed.y1});
+        }
+    }
+    return changed;
+}
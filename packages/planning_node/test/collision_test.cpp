@@ -0,0 +1,208 @@
+// Built once with the default flags and once more with AVX2 on x86, so the batch checks are
+// compared against the scalar ones for every path find_collisions takes, and both against
+// lookups in the scene cells. The internals live in an anonymous namespace, hence the source
+// include rather than linking planning_core.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wsubobject-linkage"
+#endif
+#include "src/planner_core.cpp"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+// The AVX2 build may run on a host without it.
+bool supported() {
+#if defined(__AVX2__)
+    return __builtin_cpu_supports("avx2");
+#else
+    return true;
+#endif
+}
+
+// Scene prepared the way Planner::Impl::prepare_scene does it.
+struct PreparedScene {
+    PreparedScene(const std::vector<int8_t>& cells, int width, int height, double resolution)
+      : cells(cells), width(width), height(height), resolution(resolution) {
+        json config = [] {
+            std::ifstream config_stream(PLANNING_TEST_CONFIG);
+            return json::parse(config_stream);
+        }();
+        MotionPrimitives primitives;
+        for (const json& primitive : config["primitives"]) {
+            primitives.push_back(MotionPrimitive::from_json(primitive));
+        }
+        table = PrimitiveTable::build(
+            primitives, Footprint::from_json(config["footprint"]), config["lattice"]["headings"], resolution
+        );
+        occupancy.build(cells.data(), width, height);
+        field.build(occupancy, resolution, table.padding, table.max_clearance);
+        table.index(field.stride);
+    }
+
+    CollisionTester tester() const {
+        return CollisionTester{occupancy.grid(), field};
+    }
+
+    std::vector<int8_t> cells;
+    int width;
+    int height;
+    double resolution;
+    PrimitiveTable table;
+    OccupancyPyramid occupancy;
+    DistanceField field;
+};
+
+// Per-entry scalar checks folded into the mask the batch query returns.
+uint64_t scalar_collisions(const CollisionTester& tester, Cell from, const PrimitiveTable& table) {
+    uint64_t collisions = 0;
+    for (const PrimitiveTable::Entry* entry = table.begin(from.theta); entry != table.end(from.theta); ++entry) {
+        if (tester.test(from, table, *entry)) {
+            collisions |= uint64_t{1} << (entry - table.begin(from.theta));
+        }
+    }
+    return collisions;
+}
+
+// Whether an occupied cell is closer to the checked one than the clearance, found by scanning
+// the scene cells around it rather than reading the bitmap or the distance field. Distances
+// are rounded as the field rounds them. Checked cells past the border collide.
+bool occupied_within(const PreparedScene& scene, int x, int y, float clearance) {
+    if (x < 0 || y < 0 || x >= scene.width || y >= scene.height) {
+        return true;
+    }
+    int reach = static_cast<int>(std::ceil(clearance / scene.resolution));
+    for (int dy = -reach; dy <= reach; ++dy) {
+        for (int dx = -reach; dx <= reach; ++dx) {
+            int cx = x + dx;
+            int cy = y + dy;
+            if (cx < 0 || cy < 0 || cx >= scene.width || cy >= scene.height ||
+                scene.cells[static_cast<size_t>(cy) * scene.width + cx] == 0) {
+                continue;
+            }
+            if (static_cast<float>(std::sqrt(static_cast<double>(dx * dx + dy * dy)) * scene.resolution) < clearance) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Entries with a check finding an occupied cell, folded into the mask the batch query returns.
+uint64_t lookup_collisions(const PreparedScene& scene, Cell from) {
+    const PrimitiveTable& table = scene.table;
+    uint64_t collisions = 0;
+    for (const PrimitiveTable::Entry* entry = table.begin(from.theta); entry != table.end(from.theta); ++entry) {
+        for (uint32_t i = entry->checks_begin; i < entry->checks_end; ++i) {
+            const PrimitiveTable::Check& check = table.checks[i];
+            if (occupied_within(scene, from.x + check.offset.dx, from.y + check.offset.dy, check.clearance)) {
+                collisions |= uint64_t{1} << (entry - table.begin(from.theta));
+                break;
+            }
+        }
+    }
+    return collisions;
+}
+
+// Every cell and heading, so the cells on the border have checks reaching into the padding.
+void expect_batch_matches_scalar(const PreparedScene& scene, int width, int height) {
+    CollisionTester tester = scene.tester();
+    for (int theta = 0; theta < scene.table.headings; ++theta) {
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                Cell from{x, y, theta};
+                uint64_t collisions = tester.test_all(from, scene.table);
+                ASSERT_EQ(collisions, scalar_collisions(tester, from, scene.table))
+                    << "cell " << x << ", " << y << ", heading " << theta;
+                ASSERT_EQ(collisions, lookup_collisions(scene, from))
+                    << "cell " << x << ", " << y << ", heading " << theta;
+            }
+        }
+    }
+}
+
+}  // namespace
+
+TEST(BatchCollision, MatchesScalarLoop) {
+    if (!supported()) {
+        GTEST_SKIP() << "AVX2 is not supported by this CPU";
+    }
+    std::mt19937_64 engine{1};
+    std::uniform_real_distribution<float> distance(0.0f, 2.0f);
+    std::vector<float> field(256);
+    // Counts around the vector widths exercise both the vector loop and the scalar tail.
+    for (size_t count = 0; count <= 67; ++count) {
+        for (int round = 0; round < 32; ++round) {
+            std::vector<int32_t> offsets(count);
+            std::vector<float> clearances(count);
+            std::vector<uint8_t> owners(count);
+            for (float& value : field) {
+                value = distance(engine);
+            }
+            for (size_t i = 0; i < count; ++i) {
+                offsets[i] = static_cast<int32_t>(engine() % 129) - 64;
+                // Equal distances don't collide, a quarter of the clearances hit one exactly.
+                clearances[i] = engine() % 4 == 0 ? field[128 + offsets[i]] : distance(engine);
+                owners[i] = static_cast<uint8_t>(engine() % 64);
+            }
+
+            uint64_t expected = 0;
+            for (size_t i = 0; i < count; ++i) {
+                if (field[128 + offsets[i]] < clearances[i]) {
+                    expected |= uint64_t{1} << owners[i];
+                }
+            }
+            ASSERT_EQ(
+                find_collisions(field.data() + 128, offsets.data(), clearances.data(), owners.data(), count), expected
+            ) << "count " << count;
+        }
+    }
+}
+
+TEST(BatchCollision, TesterMatchesScalarAndLookupsOnRandomScenes) {
+    if (!supported()) {
+        GTEST_SKIP() << "AVX2 is not supported by this CPU";
+    }
+    std::mt19937_64 engine{2};
+    const double resolutions[] = {0.25, 0.5, 1.0};
+    const double densities[] = {0.0, 0.05, 0.2, 0.5};
+    for (double resolution : resolutions) {
+        for (double density : densities) {
+            // Odd sizes, so rows don't line up with the tiles or the bitmap words.
+            int width = 23 + static_cast<int>(engine() % 50);
+            int height = 17 + static_cast<int>(engine() % 50);
+            std::bernoulli_distribution occupied(density);
+            std::vector<int8_t> cells(static_cast<size_t>(width) * height);
+            for (int8_t& cell : cells) {
+                cell = occupied(engine) ? 100 : 0;
+            }
+            SCOPED_TRACE(testing::Message() << "resolution " << resolution << ", density " << density);
+            expect_batch_matches_scalar(PreparedScene(cells, width, height, resolution), width, height);
+        }
+    }
+}
+
+// Primitives leaving an empty grid collide with the border only.
+TEST(BatchCollision, BorderPaddingCollides) {
+    if (!supported()) {
+        GTEST_SKIP() << "AVX2 is not supported by this CPU";
+    }
+    const int size = 24;
+    std::vector<int8_t> cells(size * size, 0);
+    PreparedScene scene(cells, size, size, 0.5);
+    CollisionTester tester = scene.tester();
+    expect_batch_matches_scalar(scene, size, size);
+
+    EXPECT_EQ(tester.test_all(Cell{size / 2, size / 2, 0}, scene.table), 0u);
+    for (int theta = 0; theta < scene.table.headings; ++theta) {
+        EXPECT_NE(tester.test_all(Cell{0, 0, theta}, scene.table), 0u) << "heading " << theta;
+        EXPECT_NE(tester.test_all(Cell{size - 1, size - 1, theta}, scene.table), 0u) << "heading " << theta;
+    }
+}
@@ -0,0 +1,69 @@
+#include "src/mailbox.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <optional>
+#include <thread>
+
+
+TEST(Mailbox, TakesLatestValueAndCountsDropped) {
+    Mailbox<int> mailbox;
+    EXPECT_FALSE(mailbox.pending());
+    mailbox.put(1);
+    mailbox.put(2);
+    mailbox.put(3);
+    EXPECT_TRUE(mailbox.pending());
+    EXPECT_EQ(mailbox.version(), 3u);
+    EXPECT_EQ(mailbox.dropped(), 2u);
+
+    EXPECT_EQ(mailbox.take(), 3);
+    EXPECT_FALSE(mailbox.pending());
+    EXPECT_EQ(mailbox.peek(), std::nullopt);
+}
+
+TEST(Mailbox, PeekKeepsValueUntilNextPut) {
+    Mailbox<int> mailbox;
+    EXPECT_EQ(mailbox.peek(), std::nullopt);
+    mailbox.put(1);
+    EXPECT_EQ(mailbox.peek(), 1);
+    EXPECT_EQ(mailbox.peek(), 1);
+    EXPECT_FALSE(mailbox.pending());
+
+    mailbox.put(2);
+    EXPECT_EQ(mailbox.peek(), 2);
+    EXPECT_EQ(mailbox.dropped(), 0u);
+}
+
+// Every slot is handed back and forth many times, values must come out in order and none twice.
+TEST(Mailbox, ConsumerSeesIncreasingValues) {
+    constexpr uint64_t count = 200000;
+    Mailbox<uint64_t> mailbox;
+    std::thread producer([&mailbox]() {
+        for (uint64_t i = 1; i <= count; ++i) {
+            mailbox.put(i);
+        }
+    });
+
+    uint64_t last = 0;
+    uint64_t taken = 0;
+    while (last < count) {
+        std::optional<uint64_t> value = mailbox.take();
+        ASSERT_TRUE(value);
+        ASSERT_GT(*value, last);
+        last = *value;
+        ++taken;
+    }
+    producer.join();
+    EXPECT_EQ(taken + mailbox.dropped(), count);
+}
+
+TEST(Mailbox, StopWakesWaitingConsumer) {
+    Mailbox<int> mailbox;
+    std::thread consumer([&mailbox]() {
+        EXPECT_EQ(mailbox.take(), std::nullopt);
+    });
+    mailbox.stop();
+    consumer.join();
+    EXPECT_EQ(mailbox.take(), std::nullopt);
+}
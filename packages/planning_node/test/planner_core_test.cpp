@@ -0,0 +1,255 @@
+#include "src/planner_core.hpp"
+#include "src/random_scene.hpp"
+
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+using planning_core::GridInfo;
+using planning_core::GridRegion;
+using planning_core::Planner;
+using planning_core::PlanStatus;
+using planning_core::PlanResult;
+using planning_core::Pose;
+using planning_core::RandomScene;
+
+nlohmann::json load_config() {
+    std::ifstream config_stream(PLANNING_TEST_CONFIG);
+    return nlohmann::json::parse(config_stream);
+}
+
+// Straight run along a single row of one meter cells, centered on the start at the origin.
+PlanStatus plan_along_row(int occupied, double target_x) {
+    Planner planner(load_config());
+    std::vector<int8_t> cells(6, 0);
+    cells[occupied] = 100;
+    planner.set_scene(GridInfo{6, 1, 1.0, -0.5, -0.5}, cells.data());
+    return planner.plan(Pose{}, Pose{target_x, 0.0, 0.0}).status;
+}
+
+// Crossing a wall at x = 4 through the gap its rows from gap_begin up to gap_end leave open. The
+// start is at the origin in the center of cell 1, 2, heading along the row.
+PlanStatus plan_through_gap(double resolution, int gap_begin, int gap_end) {
+    Planner planner(load_config());
+    const int width = 8;
+    const int height = 6;
+    std::vector<int8_t> cells(width * height, 0);
+    for (int y = 0; y < height; ++y) {
+        if (y < gap_begin || y >= gap_end) {
+            cells[y * width + 4] = 100;
+        }
+    }
+    planner.set_scene(GridInfo{width, height, resolution, -1.5 * resolution, -2.5 * resolution}, cells.data());
+    return planner.plan(Pose{}, Pose{5.0 * resolution, 0.0, 0.0}).status;
+}
+
+// Open grid of one meter cells with the origin in the center of cell 1, 5, and the cells around
+// cell 15, 5 walled in when the target is to be unreachable.
+std::vector<int8_t> open_grid(bool walled) {
+    std::vector<int8_t> cells(20 * 11, 0);
+    if (walled) {
+        for (int y = 3; y <= 7; ++y) {
+            for (int x = 13; x <= 17; ++x) {
+                cells[y * 20 + x] = y == 3 || y == 7 || x == 13 || x == 17 ? 100 : 0;
+            }
+        }
+    }
+    return cells;
+}
+
+const GridInfo open_grid_info{20, 11, 1.0, -1.5, -5.5};
+
+// Sum of the primitive weights of config.json along the path, turns are the steps changing heading.
+double path_cost(const std::vector<Pose>& path) {
+    double cost = 0.0;
+    for (size_t i = 1; i < path.size(); ++i) {
+        cost += path[i].theta != path[i - 1].theta ? 2.0 : 1.0;
+    }
+    return cost;
+}
+
+// Every plan is searched, so the results compared are those of the search mode.
+nlohmann::json search_config(const char* mode) {
+    nlohmann::json config = load_config();
+    config["mode"] = mode;
+    config["cache"]["capacity"] = 0;
+    config["revalidation"]["enabled"] = false;
+    return config;
+}
+
+PlanResult plan_from_scratch(const GridInfo& info, const int8_t* cells, Pose target) {
+    Planner planner(search_config("astar"));
+    planner.set_scene(info, cells);
+    return planner.plan(Pose{}, target);
+}
+
+}  // namespace
+
+// Front circle reaches 2.65 at the target, past the edge at 2.5 of the cell centered at 3.
+TEST(PlannerCore, FootprintHitsObstacleCellEdge) {
+    EXPECT_NE(plan_along_row(3, 2.0), PlanStatus::Found);
+}
+
+TEST(PlannerCore, FootprintClearsObstacleCellBeyondReach) {
+    EXPECT_EQ(plan_along_row(4, 2.0), PlanStatus::Found);
+}
+
+// Two meters wide for a truck half a meter wide, with half a meter to spare on either side of the row.
+TEST(PlannerCore, FootprintPassesTwoCellGap) {
+    EXPECT_EQ(plan_through_gap(1.0, 2, 4), PlanStatus::Found);
+}
+
+// Two cells are 0.4 m here, narrower than the truck.
+TEST(PlannerCore, FootprintDoesNotPassNarrowerGap) {
+    EXPECT_NE(plan_through_gap(0.2, 2, 4), PlanStatus::Found);
+}
+
+TEST(PlannerCore, CachesExhaustedSearches) {
+    Planner planner(load_config());
+    std::vector<int8_t> cells = open_grid(true);
+    planner.set_scene(open_grid_info, cells.data());
+    EXPECT_EQ(planner.plan(Pose{}, Pose{14.0, 0.0, 0.0}).status, PlanStatus::NotFound);
+
+    PlanResult again = planner.plan(Pose{}, Pose{14.0, 0.0, 0.0});
+    EXPECT_EQ(again.status, PlanStatus::NotFound);
+    EXPECT_TRUE(again.cache_hit);
+}
+
+TEST(PlannerCore, DoesNotCacheSearchesStoppedByMemoryLimit) {
+    nlohmann::json config = load_config();
+    config["lattice"]["memory_limit_mb"] = 0;
+    Planner planner(config);
+    std::vector<int8_t> cells = open_grid(false);
+    planner.set_scene(open_grid_info, cells.data());
+    PlanResult first = planner.plan(Pose{}, Pose{14.0, 0.0, 0.0});
+    EXPECT_TRUE(first.overflow);
+    EXPECT_NE(first.status, PlanStatus::Found);
+
+    EXPECT_FALSE(planner.plan(Pose{}, Pose{14.0, 0.0, 0.0}).cache_hit);
+}
+
+// The deadline passes by the first time it's looked at, after a few dozen expansions. The grid
+// heuristic would tell the target is walled in before that.
+TEST(PlannerCore, DoesNotCacheSearchesStoppedByDeadline) {
+    nlohmann::json config = load_config();
+    config["mode"] = "anytime";
+    config["heuristic"] = "euclidean";
+    config["anytime"]["deadline_ms"] = 0;
+    Planner planner(config);
+    std::vector<int8_t> cells = open_grid(true);
+    planner.set_scene(open_grid_info, cells.data());
+    EXPECT_EQ(planner.plan(Pose{}, Pose{14.0, 0.0, 0.0}).status, PlanStatus::NotFound);
+
+    EXPECT_FALSE(planner.plan(Pose{}, Pose{14.0, 0.0, 0.0}).cache_hit);
+}
+
+// A target moved into the next cell but within the tolerance keeps the last path, which ends in
+// the old cell and mustn't be cached as the path to the new one.
+TEST(PlannerCore, DoesNotCacheKeptPathForAnotherTargetCell) {
+    Planner planner(load_config());
+    std::vector<int8_t> cells = open_grid(false);
+    planner.set_scene(open_grid_info, cells.data());
+    ASSERT_EQ(planner.plan(Pose{}, Pose{4.6, 0.0, 0.0}).status, PlanStatus::Found);
+    ASSERT_TRUE(planner.plan(Pose{}, Pose{4.4, 0.0, 0.0}).bypassed);
+
+    PlanResult result = planner.plan(Pose{}, Pose{4.0, 0.0, 0.0});
+    ASSERT_EQ(result.status, PlanStatus::Found);
+    EXPECT_FALSE(result.cache_hit);
+    EXPECT_DOUBLE_EQ(result.path.back().x, 4.0);
+}
+
+// Cells changed in place are replanned from the previous search, which has to give the cost a
+// search from scratch gives.
+TEST(PlannerCore, IncrementalCostsMatchSearchFromScratch) {
+    Planner planner(search_config("incremental"));
+    std::mt19937_64 engine{3};
+    const Pose target{7.0, 5.0, 0.0};
+    RandomScene scene = planning_core::make_random_scene(engine, 10.0, 0.15, 1.0, target);
+    planner.set_scene(scene.info, scene.cells.data());
+    const GridInfo& info = planner.scene();
+
+    size_t found = 0;
+    for (int round = 0; round < 40; ++round) {
+        PlanResult result = planner.plan(Pose{}, target);
+        PlanResult expected = plan_from_scratch(info, planner.cells(), target);
+        ASSERT_EQ(result.status, expected.status) << "round " << round;
+        ASSERT_EQ(path_cost(result.path), path_cost(expected.path)) << "round " << round;
+        found += result.status == PlanStatus::Found;
+
+        // A cell along the path is blocked and occupied ones cleared, so costs go both up and down.
+        // Blocking cells the truck covers at either end would leave no path at all.
+        std::vector<std::pair<int, int>> changes;
+        std::vector<const Pose*> middle;
+        for (const Pose& pose : result.path) {
+            if (std::hypot(pose.x, pose.y) > 2.5 && std::hypot(pose.x - target.x, pose.y - target.y) > 2.5) {
+                middle.push_back(&pose);
+            }
+        }
+        if (!middle.empty()) {
+            const Pose& pose = *middle[engine() % middle.size()];
+            changes.emplace_back(
+                static_cast<int>(std::floor((pose.x - info.origin_x) / info.resolution)),
+                static_cast<int>(std::floor((pose.y - info.origin_y) / info.resolution))
+            );
+        }
+        const size_t blocked = changes.size();
+        std::vector<std::pair<int, int>> occupied;
+        for (int y = 0; y < info.height; ++y) {
+            for (int x = 0; x < info.width; ++x) {
+                if (planner.cells()[y * info.width + x] != 0) {
+                    occupied.emplace_back(x, y);
+                }
+            }
+        }
+        for (int cleared = 0; cleared < 2 && !occupied.empty(); ++cleared) {
+            changes.push_back(occupied[engine() % occupied.size()]);
+        }
+        for (size_t i = 0; i < changes.size(); ++i) {
+            auto [x, y] = changes[i];
+            planner.cells()[y * info.width + x] = i < blocked ? 100 : 0;
+            planner.changed(GridRegion{x, y, x, y});
+        }
+    }
+    // Most rounds have a path to compare.
+    EXPECT_GE(found, 30u);
+}
+
+// With time to spare the inflation gets down to one, so the last path is optimal. The Euclidean
+// heuristic leaves the inflated searches room to find worse paths first.
+TEST(PlannerCore, AnytimeConvergesToOptimalCost) {
+    nlohmann::json config = search_config("anytime");
+    config["heuristic"] = "euclidean";
+    config["anytime"]["deadline_ms"] = 10000;
+    Planner planner(config);
+    const Pose target{14.0, -11.0, 0.0};
+    for (uint64_t seed = 0; seed < 8; ++seed) {
+        std::mt19937_64 engine{seed};
+        RandomScene scene = planning_core::make_random_scene(engine, 20.0, 0.15, 1.0, target);
+        planner.set_scene(scene.info, scene.cells.data());
+        PlanResult expected = plan_from_scratch(scene.info, scene.cells.data(), target);
+
+        std::vector<double> costs;
+        PlanResult result = planner.plan(Pose{}, target, {}, [&costs](const std::vector<Pose>& path) {
+            costs.push_back(path_cost(path));
+        });
+        ASSERT_EQ(result.status, expected.status) << "seed " << seed;
+        if (result.status != PlanStatus::Found) {
+            continue;
+        }
+        EXPECT_EQ(path_cost(result.path), path_cost(expected.path)) << "seed " << seed;
+        ASSERT_FALSE(costs.empty());
+        EXPECT_EQ(costs.back(), path_cost(expected.path)) << "seed " << seed;
+        for (size_t i = 1; i < costs.size(); ++i) {
+            EXPECT_LT(costs[i], costs[i - 1]) << "seed " << seed;
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#include "src/scene_delta.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+
+namespace {
+
+using planning_core::GridRegion;
+using planning_interfaces::msg::SceneDelta;
+
+void expect_region(const GridRegion& region, int x0, int y0, int x1, int y1) {
+    EXPECT_EQ(region.x0, x0);
+    EXPECT_EQ(region.y0, y0);
+    EXPECT_EQ(region.x1, x1);
+    EXPECT_EQ(region.y1, y1);
+}
+
+}  // namespace
+
+TEST(SceneDelta, FitsWithinGrid) {
+    SceneDelta delta;
+    delta.indices = {0, 11};
+    delta.values = {100, 0};
+    delta.run_starts = {4};
+    delta.run_lengths = {8};
+    delta.run_values = {100};
+    EXPECT_TRUE(delta_fits(delta, 12));
+    EXPECT_FALSE(delta_fits(delta, 11));
+}
+
+TEST(SceneDelta, RejectsMalformedDeltas) {
+    SceneDelta mismatched;
+    mismatched.indices = {0, 1};
+    mismatched.values = {100};
+    EXPECT_FALSE(delta_fits(mismatched, 12));
+
+    SceneDelta missing_value;
+    missing_value.run_starts = {0};
+    missing_value.run_lengths = {1};
+    EXPECT_FALSE(delta_fits(missing_value, 12));
+
+    SceneDelta out_of_grid;
+    out_of_grid.run_starts = {12};
+    out_of_grid.run_lengths = {0};
+    out_of_grid.run_values = {100};
+    EXPECT_FALSE(delta_fits(out_of_grid, 12));
+
+    // Start plus length wraps around in 32 bits.
+    SceneDelta wrapping;
+    wrapping.run_starts = {4};
+    wrapping.run_lengths = {UINT32_MAX};
+    wrapping.run_values = {100};
+    EXPECT_FALSE(delta_fits(wrapping, 12));
+}
+
+// Writes of the value a cell already has don't grow the changed region.
+TEST(SceneDelta, AppliesCellsAndReportsChangedOnes) {
+    const int width = 4;
+    std::vector<int8_t> cells(width * 3, 0);
+    cells[9] = 100;
+    SceneDelta delta;
+    delta.indices = {5, 9, 0};
+    delta.values = {100, 100, 0};
+
+    GridRegion changed = apply_delta(delta, cells.data(), width);
+    expect_region(changed, 1, 1, 1, 1);
+    EXPECT_EQ(cells[5], 100);
+    EXPECT_EQ(cells[9], 100);
+    EXPECT_EQ(cells[0], 0);
+
+    EXPECT_TRUE(apply_delta(delta, cells.data(), width).empty());
+}
+
+TEST(SceneDelta, AppliesRunsAcrossRows) {
+    const int width = 4;
+    std::vector<int8_t> cells(width * 3, 0);
+    SceneDelta delta;
+    delta.run_starts = {6, 1};
+    delta.run_lengths = {3, 0};
+    delta.run_values = {100, 100};
+
+    GridRegion changed = apply_delta(delta, cells.data(), width);
+    // Cells 6 and 7 end row 1 and cell 8 starts row 2, so both rows change across the width.
+    expect_region(changed, 0, 1, width - 1, 2);
+    std::vector<int8_t> expected(width * 3, 0);
+    expected[6] = expected[7] = expected[8] = 100;
+    EXPECT_EQ(cells, expected);
+}
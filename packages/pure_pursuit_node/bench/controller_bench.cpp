@@ -0,0 +1,100 @@
+#include "src/controller.hpp"
+#include "src/trajectory.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+using geometry_msgs::msg::PoseStamped;
+
+constexpr double lookahead_distance = 1.0;
+constexpr double control_period = 0.02;
+// Truck drives beside the path, as it does while it tracks it.
+constexpr double offset = 0.1;
+
+// Winding path sampled every 5 cm, like a dense planner output.
+std::vector<PoseStamped> make_path(size_t size) {
+    std::vector<PoseStamped> path(size);
+    for (size_t i = 0; i < size; ++i) {
+        double x = 0.05 * i;
+        path[i].pose.position.x = x;
+        path[i].pose.position.y = 5.0 * std::sin(x / 3.0);
+    }
+    return path;
+}
+
+// Search the controller used before, the last pose within the lookahead over the whole path.
+void scan(benchmark::State &state) {
+    auto path = make_path(state.range(0));
+    size_t step = 0;
+    for (auto _ : state) {
+        const auto &position = path[step].pose.position;
+        double x = position.x;
+        double y = position.y + offset;
+        auto it = std::find_if(path.rbegin(), path.rend(), [x, y](const PoseStamped &p) {
+            double dx = p.pose.position.x - x;
+            double dy = p.pose.position.y - y;
+            return std::sqrt(dx * dx + dy * dy) <= lookahead_distance;
+        });
+        benchmark::DoNotOptimize(it);
+        step = (step + 1) % path.size();
+    }
+}
+
+// Exact intersection from the progress index, restarted at the beginning of every lap.
+void indexed(benchmark::State &state) {
+    auto path = make_path(state.range(0));
+    pure_pursuit::Trajectory trajectory(path);
+    size_t step = 0;
+    size_t progress = 0;
+    for (auto _ : state) {
+        const auto &position = path[step].pose.position;
+        auto target = trajectory.lookahead(position.x, position.y + offset, lookahead_distance, progress);
+        benchmark::DoNotOptimize(target);
+        if (++step == path.size()) {
+            step = 0;
+            progress = 0;
+        }
+    }
+}
+
+// Preprocessing paid once for every new path.
+void build(benchmark::State &state) {
+    auto path = make_path(state.range(0));
+    for (auto _ : state) {
+        pure_pursuit::Trajectory trajectory(path);
+        benchmark::DoNotOptimize(trajectory);
+    }
+}
+
+// Full control tick along the path.
+void control(benchmark::State &state) {
+    auto path = make_path(state.range(0));
+    pure_pursuit::Controller controller(pure_pursuit::Parameters{1.0, 0.5, 1.0, lookahead_distance});
+    controller.set_path(pure_pursuit::Trajectory(path));
+    nav_msgs::msg::Odometry odometry;
+    odometry.twist.twist.linear.x = 1.0;
+    size_t step = 0;
+    for (auto _ : state) {
+        odometry.pose.pose.position = path[step].pose.position;
+        odometry.pose.pose.position.y += offset;
+        benchmark::DoNotOptimize(controller.get_motion(odometry, control_period));
+        if (++step == path.size()) {
+            step = 0;
+            controller.set_path(pure_pursuit::Trajectory(path));
+        }
+    }
+}
+
+}
+
+BENCHMARK(scan)->RangeMultiplier(4)->Range(1 << 10, 1 << 16);
+BENCHMARK(indexed)->RangeMultiplier(4)->Range(1 << 10, 1 << 16);
+BENCHMARK(build)->RangeMultiplier(4)->Range(1 << 10, 1 << 16);
+BENCHMARK(control)->RangeMultiplier(4)->Range(1 << 10, 1 << 16);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,215 @@
+#include "control_loop.hpp"
+
+#include "tracing/trace.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using nav_msgs::msg::Odometry;
+using planning_interfaces::msg::MetaData;
+using pure_pursuit_msgs::msg::Command;
+
+namespace pure_pursuit {
+
+namespace {
+
+using microseconds = std::chrono::duration<double, std::micro>;
+
+// Absolute sleep, so time spent in the tick doesn't push the next one back. The steady clock
+// is CLOCK_MONOTONIC on Linux.
+void sleep_until(std::chrono::steady_clock::time_point deadline) {
+    auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+    timespec ts{};
+    ts.tv_sec = since_epoch / 1000000000;
+    ts.tv_nsec = since_epoch % 1000000000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+}
+
+};
+
+LoopOptions::LoopOptions(rclcpp::Node &node)
+: rate_hz(node.declare_parameter<double>("control_rate_hz", 50.0))
+, priority(node.declare_parameter<int>("control_priority", 0))
+, cpu(node.declare_parameter<int>("control_cpu", -1))
+, max_prediction(node.declare_parameter<double>("max_prediction", 0.2))
+, odometry_timeout(node.declare_parameter<double>("odometry_timeout", 0.5))
+, metadata_rate_hz(node.declare_parameter<double>("metadata_rate_hz", 0.0))
+{
+    // Both are turned into periods.
+    if (rate_hz <= 0.0) {
+        throw std::invalid_argument("control_rate_hz must be positive");
+    }
+    if (metadata_rate_hz < 0.0) {
+        throw std::invalid_argument("metadata_rate_hz must not be negative");
+    }
+}
+
+Odometry extrapolate(const Odometry &odometry, double dt) {
+    Odometry result = odometry;
+    auto &q = odometry.pose.pose.orientation;
+    auto &twist = odometry.twist.twist;
+    double yaw = 2 * std::atan2(q.z, q.w);
+    // Constant twist moves along an arc, which is its chord from the mean heading.
+    double half_turn = twist.angular.z * dt / 2;
+    double chord = std::abs(half_turn) > 1e-9 ? std::sin(half_turn) / half_turn * dt : dt;
+    double cs = std::cos(yaw + half_turn);
+    double sn = std::sin(yaw + half_turn);
+    result.pose.pose.position.x += (twist.linear.x * cs - twist.linear.y * sn) * chord;
+    result.pose.pose.position.y += (twist.linear.x * sn + twist.linear.y * cs) * chord;
+    double new_yaw = yaw + twist.angular.z * dt;
+    result.pose.pose.orientation.x = 0;
+    result.pose.pose.orientation.y = 0;
+    result.pose.pose.orientation.z = std::sin(new_yaw / 2);
+    result.pose.pose.orientation.w = std::cos(new_yaw / 2);
+    return result;
+}
+
+ControlLoop::ControlLoop(
+    const Parameters &params,
+    const LoopOptions &options,
+    rclcpp::Publisher<Command>::SharedPtr cmd_publisher,
+    rclcpp::Publisher<MetaData>::SharedPtr metadata_publisher,
+    rclcpp::Logger logger
+)
+: controller(params)
+, options(options)
+, period(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.rate_hz)))
+, cmd_publisher(cmd_publisher)
+, metadata_publisher(metadata_publisher)
+, logger(logger)
+{
+    if (metadata_publisher) {
+        metadata_period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / options.metadata_rate_hz)
+        );
+    }
+    thread = std::thread{&ControlLoop::run, this};
+}
+
+ControlLoop::~ControlLoop() {
+    stop();
+}
+
+void ControlLoop::set_path(Trajectory trajectory) {
+    controller.set_path(std::move(trajectory));
+}
+
+// Receive time rather than the stamp, which may come from another clock.
+void ControlLoop::set_odometry(const Odometry &message) {
+    odometry.publish(ReceivedOdometry{message, Clock::now()});
+}
+
+void ControlLoop::stop() {
+    running.store(false, std::memory_order_relaxed);
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void ControlLoop::run() {
+    configure_thread();
+    auto deadline = Clock::now();
+    while (running.load(std::memory_order_relaxed)) {
+        sleep_until(deadline);
+        tick(deadline);
+
+        deadline += period;
+        auto now = Clock::now();
+        if (now >= deadline) {
+            auto missed = (now - deadline) / period + 1;
+            ++stats.overruns;
+            stats.skipped += missed;
+            deadline += missed * period;
+        }
+        if (metadata_publisher) {
+            report(now);
+        }
+    }
+}
+
+// Failures leave the thread on the default scheduler, the loop still runs at its rate.
+void ControlLoop::configure_thread() {
+    tracing::name_thread("control loop");
+    if (options.priority > 0) {
+        sched_param param{};
+        param.sched_priority = options.priority;
+        int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (error != 0) {
+            RCLCPP_WARN(logger, "Can't set SCHED_FIFO priority %d: %s", options.priority, std::strerror(error));
+        }
+    }
+    if (options.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(options.cpu, &set);
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (error != 0) {
+            RCLCPP_WARN(logger, "Can't pin the control loop to CPU %d: %s", options.cpu, std::strerror(error));
+        }
+    }
+}
+
+void ControlLoop::tick(Clock::time_point deadline) {
+    auto start = Clock::now();
+    tracing::Span span{"control"};
+
+    double late_us = microseconds(start - deadline).count();
+    ++stats.ticks;
+    stats.sum_late_us += late_us;
+    stats.max_late_us = std::max(stats.max_late_us, late_us);
+
+    odometry.update();
+    const ReceivedOdometry *latest = odometry.get();
+    if (!latest || std::chrono::duration<double>(start - latest->received).count() > options.odometry_timeout) {
+        ++stats.stale;
+        return;
+    }
+    double prediction = std::min(std::chrono::duration<double>(start - latest->received).count(), options.max_prediction);
+    stats.max_prediction_us = std::max(stats.max_prediction_us, prediction * 1e6);
+    auto cmd = controller.get_motion(
+        extrapolate(latest->odometry, prediction), std::chrono::duration<double>(period).count()
+    );
+    uint64_t scene_id = controller.trajectory() ? controller.trajectory()->scene_id() : 0;
+    span.set_id(scene_id);
+    if (cmd) {
+        cmd_publisher->publish(std::make_unique<Command>(*cmd));
+        tracing::instant("command published", scene_id);
+    }
+    stats.max_compute_us = std::max(stats.max_compute_us, microseconds(Clock::now() - start).count());
+}
+
+// Ticks between messages are summarized, lateness is how long after its deadline a tick woke.
+void ControlLoop::report(Clock::time_point now) {
+    if (now - last_metadata < metadata_period) {
+        return;
+    }
+    last_metadata = now;
+
+    auto message = std::make_unique<MetaData>();
+    message->created_at = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+    message->debug = {
+        "ticks=" + std::to_string(stats.ticks),
+        "overruns=" + std::to_string(stats.overruns),
+        "skipped=" + std::to_string(stats.skipped),
+        "stale=" + std::to_string(stats.stale),
+        "max_late_us=" + std::to_string(stats.max_late_us),
+        "mean_late_us=" + std::to_string(stats.ticks > 0 ? stats.sum_late_us / stats.ticks : 0.0),
+        "max_compute_us=" + std::to_string(stats.max_compute_us),
+        "max_prediction_us=" + std::to_string(stats.max_prediction_us),
+    };
+    metadata_publisher->publish(std::move(message));
+    stats = Stats{};
+}
+
+};
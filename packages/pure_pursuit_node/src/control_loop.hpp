@@ -0,0 +1,109 @@
+#pragma once
+
+#include "nav_msgs/msg/odometry.hpp"
+#include "planning_interfaces/msg/meta_data.hpp"
+#include "pure_pursuit_msgs/msg/command.hpp"
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "controller.hpp"
+#include "handoff.hpp"
+#include "trajectory.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace pure_pursuit {
+
+struct LoopOptions {
+    // Declared here along with the controller parameters. Throws std::invalid_argument for a
+    // control rate that isn't positive or a negative metadata rate.
+    LoopOptions(rclcpp::Node &node);
+
+    LoopOptions() = default;
+
+    double rate_hz = 50.0;
+    // SCHED_FIFO priority of the loop thread, zero keeps the default scheduler.
+    int priority = 0;
+    // CPU the loop thread is pinned to, negative lets it run anywhere.
+    int cpu = -1;
+    // Odometry is extrapolated to the tick at most this far, in seconds.
+    double max_prediction = 0.2;
+    // No commands are sent once the last odometry is older, in seconds.
+    double odometry_timeout = 0.5;
+    // Loop statistics are published this often, zero leaves them off.
+    double metadata_rate_hz = 0.0;
+};
+
+// Odometry moved forward by its own twist, taken in the body frame as the controller does.
+nav_msgs::msg::Odometry extrapolate(const nav_msgs::msg::Odometry &odometry, double dt);
+
+// Runs the controller at a fixed rate on its own thread, so commands neither follow odometry
+// jitter nor wait behind other callbacks of the node. Every tick extrapolates the latest
+// odometry to the tick time, computes a command and publishes it.
+//
+// Ticks are absolute deadlines, a tick that overruns the next deadline skips the missed ones
+// instead of running them back to back. Wake-up lateness, compute time and overruns are
+// published on the metadata topic as key=value entries, in the format of the planner.
+class ControlLoop {
+public:
+    ControlLoop(
+        const Parameters &params,
+        const LoopOptions &options,
+        rclcpp::Publisher<pure_pursuit_msgs::msg::Command>::SharedPtr cmd_publisher,
+        rclcpp::Publisher<planning_interfaces::msg::MetaData>::SharedPtr metadata_publisher,
+        rclcpp::Logger logger
+    );
+
+    ~ControlLoop();
+
+    // Both are called from subscription callbacks, at most one thread each, and never wait for
+    // a tick. The trajectory is built by the caller, so a long path doesn't delay the loop.
+    void set_path(Trajectory trajectory);
+    void set_odometry(const nav_msgs::msg::Odometry &odometry);
+
+    void stop();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void run();
+    void configure_thread();
+    void tick(Clock::time_point deadline);
+    void report(Clock::time_point now);
+
+    Controller controller;
+    LoopOptions options;
+    Clock::duration period;
+    rclcpp::Publisher<pure_pursuit_msgs::msg::Command>::SharedPtr cmd_publisher;
+    rclcpp::Publisher<planning_interfaces::msg::MetaData>::SharedPtr metadata_publisher;
+    rclcpp::Logger logger;
+
+    struct ReceivedOdometry {
+        nav_msgs::msg::Odometry odometry;
+        Clock::time_point received;
+    };
+    Handoff<ReceivedOdometry> odometry;
+
+    // Owned by the loop thread.
+    struct Stats {
+        uint64_t ticks = 0;
+        uint64_t overruns = 0;
+        uint64_t skipped = 0;
+        uint64_t stale = 0;
+        double max_late_us = 0.0;
+        double sum_late_us = 0.0;
+        double max_compute_us = 0.0;
+        double max_prediction_us = 0.0;
+    };
+    Stats stats;
+    Clock::duration metadata_period{};
+    Clock::time_point last_metadata;
+
+    std::atomic<bool> running{true};
+    std::thread thread;
+};
+
+};
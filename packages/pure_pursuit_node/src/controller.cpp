@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <utility>
 
 using pure_pursuit_msgs::msg::Command;
 using namespace geometry_msgs::msg;
@@ -12,11 +13,6 @@ double quaternoin_to_flat_angle(const Quaternion &q) {
     return std::copysign(2 * std::acos(q.w), q.z);
 }
 
-template<class P1, class P2>
-double distance(const P1 &a, const P2 &b) {
-    return std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
-}
-
 struct Vector {
     double x, y;
     Vector &operator+=(const Vector &other) {
@@ -69,41 +65,45 @@ struct Vector {
 
 namespace pure_pursuit {
 
-std::optional<Command> Controller::get_motion(
-      const nav_msgs::msg::Odometry &odometry
-    , const std::vector<PoseStamped> &path
-) {
+void Controller::set_path(Trajectory path) {
+    SpeedProfile profile(path, params.max_velocity, params.max_accel, params.max_lateral_accel);
+    plans.publish(Plan{std::move(path), std::move(profile)});
+}
+
+std::optional<Command> Controller::get_motion(const nav_msgs::msg::Odometry &odometry, double dt) {
+    if (plans.update()) {
+        progress = 0;
+    }
+    const Plan *plan = plans.get();
+    if (!plan)
+        return std::nullopt;
+    const Trajectory &trajectory = plan->trajectory;
     auto &position = odometry.pose.pose.position;
-    auto it = std::find_if(path.rbegin(), path.rend(), [&position, this](const PoseStamped &p) {
-        return distance(p.pose.position, position) <= params.lookahead_distance;
-    });
-    if (it == path.rend())
+    auto target = trajectory.lookahead(position.x, position.y, params.lookahead_distance, progress);
+    if (!target)
         return std::nullopt;
     Vector p0{position.x, position.y};
-    Vector p{it->pose.position.x, it->pose.position.y};
+    Vector p{target->x, target->y};
     p -= p0;
     p = p.rotate(-quaternoin_to_flat_angle(odometry.pose.pose.orientation));
-    bool sign = std::signbit(p.y);
-    p.y = std::abs(p.y);
-    double r = dot(p, p) / (2 * p.y);
-    Vector center{0, r};
-    auto target_angle = (p - center).angle();
-    double dist;
-    if (r < 1e4) {
-        dist = r * target_angle;
-    } else {
-        if (p.x < 0) {
-            return std::nullopt;
-        }
-        dist = p.x;
+    // Arc tangent to the heading through the target, its curvature is 2 * y / |p|^2 in the
+    // truck frame. A target straight behind can't be reached by one.
+    double len2 = dot(p, p);
+    if (len2 == 0 || (p.x < 0 && 2e4 * std::abs(p.y) <= len2)) {
+        return std::nullopt;
     }
-    auto new_velocity = params.max_velocity;
-    double time = dist / new_velocity;
+    double curvature = 2 * p.y / len2;
+
+    Vector direction{odometry.twist.twist.linear.x, odometry.twist.twist.linear.y};
+    double speed = direction.len();
+    double new_velocity = std::min(
+        plan->profile.speed(trajectory.project(progress, position.x, position.y)), speed + params.max_accel * dt
+    );
 
     Command result;
 
-    Vector direction{odometry.twist.twist.linear.x, odometry.twist.twist.linear.y};
-    direction *= new_velocity / direction.len();
+    // Straight ahead when standing still.
+    direction = speed > 0 ? direction * (new_velocity / speed) : Vector{new_velocity, 0};
 
     result.velocity.linear.x = direction.x;
     result.velocity.linear.y = direction.y;
@@ -111,10 +111,7 @@ std::optional<Command> Controller::get_motion(
 
     result.velocity.angular.x = 0;
     result.velocity.angular.y = 0;
-    result.velocity.angular.z = -target_angle / time;
-
-    if (sign)
-        result.velocity.angular.z *= -1;
+    result.velocity.angular.z = new_velocity * curvature;
 
     return result;
 }
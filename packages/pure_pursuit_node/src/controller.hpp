@@ -1,37 +1,59 @@
 #pragma once
 
-#include "geometry_msgs/msg/pose_stamped.hpp"
 #include "nav_msgs/msg/odometry.hpp"
 #include "pure_pursuit_msgs/msg/command.hpp"
 
-#include "rclcpp/rclcpp.hpp"
+#include "handoff.hpp"
+#include "speed_profile.hpp"
+#include "trajectory.hpp"
 
-#include <vector>
 #include <optional>
 
 namespace pure_pursuit {
 
+// Node parameters are read by parameters_from in node.hpp, so the controller builds without rclcpp.
 struct Parameters {
-    Parameters(const rclcpp::Node &node)
-    : max_velocity(node.get_parameter("max_velocity").get_value<double>())
-    , max_accel(node.get_parameter("max_accel").get_value<double>())
-    , lookahead_distance(node.get_parameter("lookahead_distance").get_value<double>())
+    Parameters(double max_velocity, double max_accel, double max_lateral_accel, double lookahead_distance)
+    : max_velocity(max_velocity)
+    , max_accel(max_accel)
+    , max_lateral_accel(max_lateral_accel)
+    , lookahead_distance(lookahead_distance)
     {}
 
     double max_velocity;
     double max_accel;
+    double max_lateral_accel;
     double lookahead_distance;
 };
 
+// Paths and control ticks may come from two threads: set_path is called by one of them and
+// get_motion, which switches to the latest path, by the other.
 class Controller {
 private:
+    struct Plan {
+        Trajectory trajectory;
+        SpeedProfile profile;
+    };
+
     Parameters params;
+    Handoff<Plan> plans;
+    // Segment of the current trajectory the lookahead search starts from.
+    size_t progress = 0;
 public:
     Controller(const Parameters &params): params{params} {}
-    std::optional<pure_pursuit_msgs::msg::Command> get_motion(
-          const nav_msgs::msg::Odometry &odometry
-        , const std::vector<geometry_msgs::msg::PoseStamped> &path
-    );
+
+    // Followed from its start from the next get_motion on. Its speed profile is built here.
+    void set_path(Trajectory path);
+
+    // Command for the next dt seconds. It speeds up from the odometry speed by at most max_accel
+    // over them, as the speed profile doesn't know how fast the truck goes when a path arrives.
+    std::optional<pure_pursuit_msgs::msg::Command> get_motion(const nav_msgs::msg::Odometry &odometry, double dt);
+
+    // Trajectory the last get_motion followed, null before the first path. Same thread as get_motion.
+    const Trajectory *trajectory() const {
+        const Plan *plan = plans.get();
+        return plan ? &plan->trajectory : nullptr;
+    }
 };
 
 };
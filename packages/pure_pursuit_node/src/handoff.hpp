@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace pure_pursuit {
+
+// Passes immutable values from one writer thread to one reader thread without locks, the
+// reader keeps using its value until it picks up a newer one. A value published before the
+// reader got to it is replaced and freed by the writer.
+//
+// The reader neither allocates nor frees: values it replaced are pushed onto a retired list
+// and freed by the writer on its next publish, so a real-time reader never waits on the
+// allocator. An update is an exchange and a push onto the retired list, which retries only
+// when the writer takes the list at the same moment.
+template <typename T>
+class Handoff {
+public:
+    Handoff() = default;
+    Handoff(const Handoff&) = delete;
+    Handoff& operator=(const Handoff&) = delete;
+
+    // Both threads must be done with the handoff.
+    ~Handoff() {
+        delete pending.load(std::memory_order_acquire);
+        delete current;
+        reclaim();
+    }
+
+    // Writer side.
+    void publish(T value) {
+        reclaim();
+        delete pending.exchange(new Node{std::move(value)}, std::memory_order_acq_rel);
+    }
+
+    // Reader side, switches to the latest published value. Returns whether it changed.
+    bool update() {
+        Node* fresh = pending.exchange(nullptr, std::memory_order_acquire);
+        if (!fresh) {
+            return false;
+        }
+        if (current) {
+            retire(current);
+        }
+        current = fresh;
+        return true;
+    }
+
+    // Reader side, value picked up by the last update, null until something is published.
+    const T* get() const {
+        return current ? &current->value : nullptr;
+    }
+
+private:
+    struct Node {
+        T value;
+        Node* next = nullptr;
+    };
+
+    void retire(Node* node) {
+        node->next = retired.load(std::memory_order_relaxed);
+        while (!retired.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+    void reclaim() {
+        Node* node = retired.exchange(nullptr, std::memory_order_acquire);
+        while (node) {
+            delete std::exchange(node, node->next);
+        }
+    }
+
+    std::atomic<Node*> pending{nullptr};
+    std::atomic<Node*> retired{nullptr};
+    // Owned by the reader.
+    Node* current = nullptr;
+};
+
+};
@@ -0,0 +1,5 @@
+#include "node.hpp"
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+RCLCPP_COMPONENTS_REGISTER_NODE(pure_pursuit::PursuitNode)
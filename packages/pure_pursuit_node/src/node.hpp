@@ -1,41 +1,69 @@
 #pragma once
 
+#include "planning_interfaces/msg/meta_data.hpp"
 #include "planning_interfaces/msg/path.hpp"
 #include "nav_msgs/msg/odometry.hpp"
 #include "pure_pursuit_msgs/msg/command.hpp"
 
 #include "rclcpp/rclcpp.hpp"
 
+#include "control_loop.hpp"
 #include "controller.hpp"
+#include "tracing/trace.hpp"
 
-#include <optional>
 #include <memory>
 
 namespace pure_pursuit {
 
+// Declared here, a component is loaded without automatically declared overrides.
+inline Parameters parameters_from(rclcpp::Node &node) {
+    return Parameters(
+        node.declare_parameter<double>("max_velocity", 1.0),
+        node.declare_parameter<double>("max_accel", 0.5),
+        node.declare_parameter<double>("max_lateral_accel", 1.0),
+        node.declare_parameter<double>("lookahead_distance", 1.0)
+    );
+}
+
+// Callbacks only hand messages to the control loop, which sends commands from its own thread.
 class PursuitNode : public rclcpp::Node {
 public:
-    PursuitNode()
-        : Node("PursuitNode")
-        , controller(Parameters(*this))
+    explicit PursuitNode(const rclcpp::NodeOptions &options)
+        : Node("PursuitNode", options)
     {
+        tracing::start_from_env();
+        Parameters params = parameters_from(*this);
+        LoopOptions loop_options(*this);
+
+        cmd_publisher = create_publisher<pure_pursuit_msgs::msg::Command>("command", 1);
+        if (loop_options.metadata_rate_hz > 0.0) {
+            metadata_publisher = create_publisher<planning_interfaces::msg::MetaData>("control_metadata", 10);
+        }
+        loop = std::make_unique<ControlLoop>(params, loop_options, cmd_publisher, metadata_publisher, get_logger());
+
+        // A group each, so a multi-threaded executor builds a long path while odometry still
+        // comes in, and each callback stays the only writer of its handoff.
+        rclcpp::SubscriptionOptions path_options;
+        path_options.callback_group = create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+        rclcpp::SubscriptionOptions state_options;
+        state_options.callback_group = create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+
         slot_path = this->create_subscription<planning_interfaces::msg::Path>(
             "planned_path",
             1,
             [this](planning_interfaces::msg::Path::UniquePtr path) {
-                trajectory = std::move(path->path.poses);
-            }
+                tracing::instant("path received", path->scene_id);
+                loop->set_path(Trajectory(path->path.poses, path->scene_id));
+            },
+            path_options
         );
         slot_state = Node::create_subscription<nav_msgs::msg::Odometry>(
             "current_state",
             1,
             [this](nav_msgs::msg::Odometry::UniquePtr odometry) {
-                if (trajectory) {
-                    auto cmd = controller.get_motion(*odometry, *trajectory);
-                    if (cmd)
-                        cmd_publisher->publish(*cmd);
-                }
-            }
+                loop->set_odometry(*odometry);
+            },
+            state_options
         );
     }
 
@@ -43,9 +71,10 @@ private:
     rclcpp::Subscription<planning_interfaces::msg::Path>::SharedPtr slot_path;
     rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr slot_state;
     rclcpp::Publisher<pure_pursuit_msgs::msg::Command>::SharedPtr cmd_publisher;
-    std::optional<std::vector<geometry_msgs::msg::PoseStamped>> trajectory;
+    rclcpp::Publisher<planning_interfaces::msg::MetaData>::SharedPtr metadata_publisher;
 
-    Controller controller;
+    // Declared last, so its thread is joined before the publishers it uses go away.
+    std::unique_ptr<ControlLoop> loop;
 };
 
-};
\ No newline at end of file
+};
@@ -0,0 +1,77 @@
+#include "speed_profile.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pure_pursuit {
+
+SpeedProfile::SpeedProfile(
+    const Trajectory &trajectory, double max_velocity, double max_accel, double max_lateral_accel
+) {
+    size_t size = trajectory.size();
+    if (size < 2 || trajectory.arc_length(size - 1) <= 0.0) {
+        return;
+    }
+
+    std::vector<double> limits(size);
+    for (size_t i = 0; i < size; ++i) {
+        double curvature = std::abs(trajectory.curvature(i));
+        double v2 = max_velocity * max_velocity;
+        if (curvature > 0.0) {
+            v2 = std::min(v2, max_lateral_accel / curvature);
+        }
+        limits[i] = v2;
+    }
+    // v^2 grows by at most 2 * a * ds between points, in either direction.
+    for (size_t i = 1; i < size; ++i) {
+        double ds = trajectory.arc_length(i) - trajectory.arc_length(i - 1);
+        limits[i] = std::min(limits[i], limits[i - 1] + 2 * max_accel * ds);
+    }
+    limits[size - 1] = 0.0;
+    for (size_t i = size - 1; i-- > 0;) {
+        double ds = trajectory.arc_length(i + 1) - trajectory.arc_length(i);
+        limits[i] = std::min(limits[i], limits[i + 1] + 2 * max_accel * ds);
+    }
+
+    // As many samples as points, at the mean point spacing.
+    double length = trajectory.arc_length(size - 1);
+    double step = length / (size - 1);
+    inverse_step = 1.0 / step;
+    speeds2.resize(size);
+    size_t segment = 0;
+    for (size_t j = 0; j < size; ++j) {
+        double s = std::min(j * step, length);
+        while (segment + 2 < size && trajectory.arc_length(segment + 1) < s) {
+            ++segment;
+        }
+        double start = trajectory.arc_length(segment);
+        double ds = trajectory.arc_length(segment + 1) - start;
+        double t = ds > 0.0 ? std::clamp((s - start) / ds, 0.0, 1.0) : 1.0;
+        speeds2[j] = limits[segment] + t * (limits[segment + 1] - limits[segment]);
+    }
+    // Samples on both sides of a point are kept under its limit, so no lookup between them
+    // goes over it.
+    for (size_t i = 0; i < size; ++i) {
+        size_t j = std::min(static_cast<size_t>(trajectory.arc_length(i) * inverse_step), size - 1);
+        speeds2[j] = std::min(speeds2[j], limits[i]);
+        if (j + 1 < size) {
+            speeds2[j + 1] = std::min(speeds2[j + 1], limits[i]);
+        }
+    }
+    speeds2.back() = 0.0;
+}
+
+double SpeedProfile::speed(double arc_length) const {
+    if (speeds2.empty()) {
+        return 0.0;
+    }
+    double position = std::max(arc_length, 0.0) * inverse_step;
+    size_t i = static_cast<size_t>(position);
+    if (i + 1 >= speeds2.size()) {
+        return 0.0;
+    }
+    double t = position - i;
+    return std::sqrt(std::max(speeds2[i] + t * (speeds2[i + 1] - speeds2[i]), 0.0));
+}
+
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "trajectory.hpp"
+
+#include <vector>
+
+namespace pure_pursuit {
+
+// Highest speed along a trajectory by arc length. Points are capped by max_velocity and by
+// the lateral acceleration in their curvature, then a forward pass limits how fast the truck
+// speeds up after a slow point and a backward pass how late it brakes before one, both with
+// max_accel. The start is capped by its curvature only, Controller::get_motion limits speeding
+// up from the speed the truck has, and the truck stops at the last point.
+//
+// Speeds are resampled at an even arc length step, so a lookup is O(1) whatever the path.
+class SpeedProfile {
+public:
+    SpeedProfile() = default;
+    SpeedProfile(const Trajectory &trajectory, double max_velocity, double max_accel, double max_lateral_accel);
+
+    // Zero past the last point and for an empty trajectory.
+    double speed(double arc_length) const;
+
+private:
+    // Squared, which is linear in arc length under constant acceleration.
+    std::vector<double> speeds2;
+    double inverse_step = 0.0;
+};
+
+};
@@ -0,0 +1,114 @@
+#include "trajectory.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pure_pursuit {
+
+Trajectory::Trajectory(const std::vector<geometry_msgs::msg::PoseStamped> &poses, uint64_t scene_id)
+: scene(scene_id) {
+    points.reserve(poses.size());
+    arc_lengths.reserve(poses.size());
+    for (const auto &pose : poses) {
+        PathPoint point{pose.pose.position.x, pose.pose.position.y};
+        if (points.empty()) {
+            arc_lengths.push_back(0.0);
+        } else {
+            PathPoint direction{point.x - points.back().x, point.y - points.back().y};
+            double length2 = direction.x * direction.x + direction.y * direction.y;
+            directions.push_back(direction);
+            lengths2.push_back(length2);
+            headings.push_back(std::atan2(direction.y, direction.x));
+            arc_lengths.push_back(arc_lengths.back() + std::sqrt(length2));
+        }
+        points.push_back(point);
+    }
+
+    // Circle through three points has curvature 2 * sin(angle at the middle) / opposite side,
+    // which is 2 * cross / product of the three sides.
+    curvatures.assign(points.size(), 0.0);
+    for (size_t i = 1; i + 1 < points.size(); ++i) {
+        const PathPoint &a = directions[i - 1];
+        const PathPoint &b = directions[i];
+        double cross = a.x * b.y - a.y * b.x;
+        double ax = a.x + b.x;
+        double ay = a.y + b.y;
+        double sides = std::sqrt(lengths2[i - 1] * lengths2[i] * (ax * ax + ay * ay));
+        curvatures[i] = sides > 0.0 ? 2 * cross / sides : 0.0;
+    }
+}
+
+std::optional<PathPoint> Trajectory::lookahead(double x, double y, double radius, size_t &progress) const {
+    if (points.empty()) {
+        return std::nullopt;
+    }
+    double radius2 = radius * radius;
+    auto inside = [&](size_t i) {
+        double dx = points[i].x - x;
+        double dy = points[i].y - y;
+        return dx * dx + dy * dy <= radius2;
+    };
+
+    size_t last = points.size() - 1;
+    if (last == 0) {
+        return inside(0) ? std::optional<PathPoint>{points[0]} : std::nullopt;
+    }
+    progress = std::min(progress, last - 1);
+    while (progress + 1 < last &&
+           (inside(progress + 1) || segment_distance2(progress + 1, x, y) < segment_distance2(progress, x, y))) {
+        ++progress;
+    }
+    if (progress + 1 == last && inside(last)) {
+        return points[last];
+    }
+
+    // Exit point is the larger root of |a + t * d - position| = radius.
+    const PathPoint &a = points[progress];
+    const PathPoint &d = directions[progress];
+    double length2 = lengths2[progress];
+    if (length2 == 0.0) {
+        return std::nullopt;
+    }
+    double fx = a.x - x;
+    double fy = a.y - y;
+    double half_b = fx * d.x + fy * d.y;
+    double c = fx * fx + fy * fy - radius2;
+    double discriminant = half_b * half_b - length2 * c;
+    if (discriminant < 0.0) {
+        return std::nullopt;
+    }
+    double t = (-half_b + std::sqrt(discriminant)) / length2;
+    if (t > 1.0) {
+        return std::nullopt;
+    }
+    // Circle is behind the segment start after the position jittered back, keep aiming at it.
+    if (t < 0.0) {
+        return a;
+    }
+    return PathPoint{a.x + t * d.x, a.y + t * d.y};
+}
+
+double Trajectory::project(size_t i, double x, double y) const {
+    if (i >= directions.size()) {
+        return arc_lengths.empty() ? 0.0 : arc_lengths.back();
+    }
+    double t = segment_position(i, x, y);
+    return arc_lengths[i] + t * (arc_lengths[i + 1] - arc_lengths[i]);
+}
+
+double Trajectory::segment_position(size_t i, double x, double y) const {
+    double fx = x - points[i].x;
+    double fy = y - points[i].y;
+    return lengths2[i] > 0.0 ? std::clamp((fx * directions[i].x + fy * directions[i].y) / lengths2[i], 0.0, 1.0) : 0.0;
+}
+
+double Trajectory::segment_distance2(size_t i, double x, double y) const {
+    double fx = x - points[i].x;
+    double fy = y - points[i].y;
+    double t = segment_position(i, x, y);
+    double dx = fx - t * directions[i].x;
+    double dy = fy - t * directions[i].y;
+    return dx * dx + dy * dy;
+}
+
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "geometry_msgs/msg/pose_stamped.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace pure_pursuit {
+
+struct PathPoint {
+    double x;
+    double y;
+};
+
+// Path preprocessed once for lookahead queries and left immutable, so the controller can read
+// it while the next one is built on another thread. Segment i joins points i and i + 1.
+class Trajectory {
+public:
+    Trajectory() = default;
+    explicit Trajectory(const std::vector<geometry_msgs::msg::PoseStamped> &poses, uint64_t scene_id = 0);
+
+    // Scene the path was planned on.
+    uint64_t scene_id() const {
+        return scene;
+    }
+
+    size_t size() const {
+        return points.size();
+    }
+
+    bool empty() const {
+        return points.empty();
+    }
+
+    const PathPoint &point(size_t i) const {
+        return points[i];
+    }
+
+    // Distance along the path from the first point.
+    double arc_length(size_t i) const {
+        return arc_lengths[i];
+    }
+
+    // Distance along the path to the point of segment i closest to the position.
+    double project(size_t i, double x, double y) const;
+
+    // Direction of segment i.
+    double heading(size_t i) const {
+        return headings[i];
+    }
+
+    // Signed curvature at point i, of the circle through it and its neighbours, zero at the
+    // ends. Positive turns left.
+    double curvature(size_t i) const {
+        return curvatures[i];
+    }
+
+    // Point where the circle around the position leaves the path, searched from the segment
+    // reached so far. Progress only moves forward, past segments ending inside the circle and
+    // past segments the position is closer to the next of, so a control tick is amortized O(1).
+    // The last point is returned once it is inside the circle and the start of the segment
+    // reached once the circle falls behind it. Returns nothing if the circle misses the path.
+    std::optional<PathPoint> lookahead(double x, double y, double radius, size_t &progress) const;
+
+private:
+    // Fraction of segment i to the point closest to the position.
+    double segment_position(size_t i, double x, double y) const;
+    double segment_distance2(size_t i, double x, double y) const;
+
+    uint64_t scene = 0;
+    std::vector<PathPoint> points;
+    std::vector<double> arc_lengths;
+    std::vector<double> curvatures;
+    // Direction, squared length and heading of every segment.
+    std::vector<PathPoint> directions;
+    std::vector<double> lengths2;
+    std::vector<double> headings;
+};
+
+};
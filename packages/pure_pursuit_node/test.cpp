@@ -1,37 +1,54 @@
-#include "controller.hpp"
+#include "src/controller.hpp"
 
-#include <vector>
-#include <iostream>
 #include <cmath>
+#include <iostream>
+#include <vector>
+
+using namespace pure_pursuit;
 
+// Drives a kinematic truck along a square with the controller and prints
+// "time x y yaw velocity" for every tick until it stops at the last point.
 int main() {
-    Controller ctrl(Parameters{100, 0, 1, 6});
-    std::vector<Point> path = {
-        {0, 0, 0, 0, 0},
-        {0, 5, 5, 0, 0},
-        {0, 10, 10, 0, 0},
-        {5, 10, 15, 0, 0},
-        {10, 10, 20, 0, 0},
-        {10, 5, 25, 0, 0},
-        {10, 0, 30, 0, 0}
-    };
-    double T = 40;
-    double dt = 0.1;
-    Point pos = {0, 0, 0, M_PI / 2, 0};
-    double cur_v = 0;
+    Controller ctrl(Parameters{2.0, 0.5, 0.5, 1.0});
+    std::vector<std::pair<double, double>> corners = {{0, 0}, {0, 10}, {10, 10}, {10, 0}};
+    std::vector<geometry_msgs::msg::PoseStamped> path;
+    for (size_t i = 0; i + 1 < corners.size(); ++i) {
+        auto [x0, y0] = corners[i];
+        auto [x1, y1] = corners[i + 1];
+        for (int k = 0; k < 20; ++k) {
+            path.emplace_back();
+            path.back().pose.position.x = x0 + (x1 - x0) * k / 20;
+            path.back().pose.position.y = y0 + (y1 - y0) * k / 20;
+        }
+    }
+    path.emplace_back();
+    path.back().pose.position.x = corners.back().first;
+    path.back().pose.position.y = corners.back().second;
+    ctrl.set_path(Trajectory(path));
+
+    double T = 60;
+    double dt = 0.05;
+    double x = 0, y = 0, yaw = M_PI / 2, v = 0;
     for (double t = 0; t < T; t += dt) {
-        pos.time = t;
-        auto opt = ctrl.get_motion(pos, cur_v, path);
-        if (!opt) {
+        nav_msgs::msg::Odometry odometry;
+        odometry.pose.pose.position.x = x;
+        odometry.pose.pose.position.y = y;
+        odometry.pose.pose.orientation.z = std::sin(yaw / 2);
+        odometry.pose.pose.orientation.w = std::cos(yaw / 2);
+        odometry.twist.twist.linear.x = v;
+        auto cmd = ctrl.get_motion(odometry, dt);
+        if (!cmd) {
             std::cout << "No way(\n";
             break;
         }
-        auto [sigma, v] = *opt;
-        std::cout << pos.time << " " << pos.x << " " << pos.y << " " << pos.venicle_angle << " " << v << "\n";
-        pos.x += std::cos(pos.venicle_angle) * v;
-        pos.y += std::sin(pos.venicle_angle) * v;
-        pos.wheels_angle = sigma;
-        pos.venicle_angle += std::tan(pos.wheels_angle) * v;
-        cur_v = v;
+        v = cmd->velocity.linear.x;
+        double w = cmd->velocity.angular.z;
+        std::cout << t << " " << x << " " << y << " " << yaw << " " << v << "\n";
+        if (v <= 0) {
+            break;
+        }
+        x += std::cos(yaw) * v * dt;
+        y += std::sin(yaw) * v * dt;
+        yaw += w * dt;
     }
 }
@@ -0,0 +1,61 @@
+#include "src/controller.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+
+namespace {
+
+using namespace pure_pursuit;
+
+// Straight path along x sampled every 10 cm.
+Trajectory straight_path(double length) {
+    std::vector<geometry_msgs::msg::PoseStamped> path(static_cast<size_t>(length * 10) + 1);
+    for (size_t i = 0; i < path.size(); ++i) {
+        path[i].pose.position.x = 0.1 * i;
+    }
+    return Trajectory(path);
+}
+
+nav_msgs::msg::Odometry odometry_at(double x, double velocity) {
+    nav_msgs::msg::Odometry odometry;
+    odometry.pose.pose.position.x = x;
+    odometry.pose.pose.orientation.w = 1.0;
+    odometry.twist.twist.linear.x = velocity;
+    return odometry;
+}
+
+}  // namespace
+
+// The profile allows full speed at the start of a straight path, the truck at rest gets there
+// at max_accel.
+TEST(Controller, SpeedsUpFromRestAtMaxAccel) {
+    const double max_accel = 0.5;
+    const double dt = 0.02;
+    Controller controller(Parameters{2.0, max_accel, 1.0, 1.0});
+    controller.set_path(straight_path(20.0));
+
+    double x = 0.0;
+    double velocity = 0.0;
+    for (int tick = 0; tick < 100; ++tick) {
+        auto command = controller.get_motion(odometry_at(x, velocity), dt);
+        ASSERT_TRUE(command);
+        double next = command->velocity.linear.x;
+        ASSERT_LE(next, velocity + max_accel * dt + 1e-9) << "tick " << tick;
+        ASSERT_GT(next, velocity) << "tick " << tick;
+        velocity = next;
+        x += velocity * dt;
+    }
+    EXPECT_NEAR(velocity, 100 * max_accel * dt, 1e-9);
+}
+
+// Speed the truck already has isn't cut down to what it could reach from rest.
+TEST(Controller, KeepsSpeedOfMovingTruck) {
+    Controller controller(Parameters{2.0, 0.5, 1.0, 1.0});
+    controller.set_path(straight_path(20.0));
+    auto command = controller.get_motion(odometry_at(0.0, 1.5), 0.02);
+    ASSERT_TRUE(command);
+    EXPECT_NEAR(command->velocity.linear.x, 1.51, 1e-9);
+}
@@ -0,0 +1,517 @@
+#include "planning_node/planner_core.hpp"
+#include "planning_node/random_scene.hpp"
+#include "pure_pursuit_node/controller.hpp"
+
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+// Drives a kinematic truck through seeded random scenes with the planner core and the pure
+// pursuit controller, without a ROS graph and as fast as the CPU allows. Episodes run in
+// parallel, each on one thread with a planner and a controller of its own, and every one is
+// reproducible from its seed.
+//
+//   simulator <config.json> [--episodes N] [--threads N] [--seed N] [--duration SECONDS]
+//             [--radius METERS] [--density FRACTION] [--replan-period SECONDS] [--control-rate HZ]
+//             [--min-reachable FRACTION]
+//
+// Exits with 1 if the footprint of a truck hit an obstacle, a truck didn't reach its target in
+// time, or fewer than the minimum fraction of the episodes had a path at all, since the verdict
+// says little about a run that mostly left its scenes out.
+
+namespace {
+
+using planning_core::GridInfo;
+using planning_core::PlanStatus;
+using planning_core::Pose;
+
+struct Options {
+    std::string config_path;
+    size_t episodes = 64;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t seed = 0;
+    // Simulated seconds an episode may take to reach its target.
+    double duration = 60.0;
+    double radius = 20.0;
+    double density = 0.03;
+    // Simulated seconds between plans, as the planner replans on every scene.
+    double replan_period = 0.5;
+    double control_rate = 50.0;
+    double min_reachable = 0.9;
+};
+
+enum class Outcome {
+    Reached,
+    Collided,
+    TimedOut,
+    // No path from the start, the scene is left out of the verdict.
+    Unreachable,
+};
+
+struct Episode {
+    Outcome outcome = Outcome::TimedOut;
+    double simulated_s = 0.0;
+    double wall_s = 0.0;
+    size_t replans = 0;
+    size_t failed_plans = 0;
+    // Ticks the controller had no target and the truck stood still.
+    size_t lost_ticks = 0;
+    double error_sum = 0.0;
+    double error_max = 0.0;
+    size_t ticks = 0;
+    std::vector<double> control_us;
+    std::vector<double> plan_us;
+};
+
+struct Scene {
+    GridInfo info;
+    std::vector<int8_t> cells;
+
+    // Whether the circle reaches into an occupied cell or out of the grid. Cells it only touches
+    // don't count, as in the planner.
+    bool occupied(double x, double y, double radius) const {
+        int x0 = static_cast<int>(std::floor((x - radius - info.origin_x) / info.resolution));
+        int x1 = static_cast<int>(std::floor((x + radius - info.origin_x) / info.resolution));
+        int y0 = static_cast<int>(std::floor((y - radius - info.origin_y) / info.resolution));
+        int y1 = static_cast<int>(std::floor((y + radius - info.origin_y) / info.resolution));
+        for (int cy = y0; cy <= y1; ++cy) {
+            for (int cx = x0; cx <= x1; ++cx) {
+                double left = info.origin_x + cx * info.resolution;
+                double bottom = info.origin_y + cy * info.resolution;
+                double dx = x - std::clamp(x, left, left + info.resolution);
+                double dy = y - std::clamp(y, bottom, bottom + info.resolution);
+                if (dx * dx + dy * dy >= radius * radius) {
+                    continue;
+                }
+                if (cx < 0 || cy < 0 || cx >= info.width || cy >= info.height ||
+                    cells[static_cast<size_t>(cy) * info.width + cx] != 0) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+};
+
+// Vehicle shape as circles in the vehicle frame, as the planner configuration gives it.
+struct Circle {
+    double x;
+    double y;
+    double radius;
+};
+
+std::vector<Circle> footprint_from_json(const nlohmann::json& footprint) {
+    std::vector<Circle> circles;
+    for (const nlohmann::json& circle : footprint["circles"]) {
+        circles.push_back(Circle{circle["x"], circle["y"], circle["radius"]});
+    }
+    return circles;
+}
+
+// Whether any circle of the footprint at the pose reaches into an occupied cell.
+bool collides(const Scene& scene, const std::vector<Circle>& footprint, const Pose& pose) {
+    double cs = std::cos(pose.theta);
+    double sn = std::sin(pose.theta);
+    for (const Circle& circle : footprint) {
+        double x = pose.x + circle.x * cs - circle.y * sn;
+        double y = pose.y + circle.x * sn + circle.y * cs;
+        if (scene.occupied(x, y, circle.radius)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Distance from the point to the polyline.
+double distance_to_path(const std::vector<Pose>& path, double x, double y) {
+    double best = path.empty() ? 0.0 : std::hypot(path[0].x - x, path[0].y - y);
+    for (size_t i = 1; i < path.size(); ++i) {
+        double dx = path[i].x - path[i - 1].x;
+        double dy = path[i].y - path[i - 1].y;
+        double length2 = dx * dx + dy * dy;
+        double t = 0.0;
+        if (length2 > 0.0) {
+            t = std::clamp(((x - path[i - 1].x) * dx + (y - path[i - 1].y) * dy) / length2, 0.0, 1.0);
+        }
+        best = std::min(best, std::hypot(path[i - 1].x + t * dx - x, path[i - 1].y + t * dy - y));
+    }
+    return best;
+}
+
+// Pose in the frame of the truck.
+Pose to_truck_frame(const Pose& truck, const Pose& pose) {
+    double cs = std::cos(truck.theta);
+    double sn = std::sin(truck.theta);
+    double dx = pose.x - truck.x;
+    double dy = pose.y - truck.y;
+    return Pose{dx * cs + dy * sn, -dx * sn + dy * cs, pose.theta - truck.theta};
+}
+
+Pose from_truck_frame(const Pose& truck, const Pose& pose) {
+    double cs = std::cos(truck.theta);
+    double sn = std::sin(truck.theta);
+    return Pose{truck.x + pose.x * cs - pose.y * sn, truck.y + pose.x * sn + pose.y * cs, pose.theta + truck.theta};
+}
+
+// Scene as the unwrapping node publishes it, centered on the truck and turned with it. A cell is
+// occupied if it overlaps an occupied world cell or reaches out of the world, so rotation neither
+// thins obstacles out nor opens gaps the truck doesn't fit through.
+Scene truck_scene(const Scene& world, const Pose& truck) {
+    Scene scene;
+    scene.info = world.info;
+    scene.info.origin_x = -(world.info.width / 2 + 0.5) * world.info.resolution;
+    scene.info.origin_y = -(world.info.height / 2 + 0.5) * world.info.resolution;
+    scene.cells.resize(world.cells.size());
+    double resolution = world.info.resolution;
+    double cs = std::cos(truck.theta);
+    double sn = std::sin(truck.theta);
+    for (int y = 0; y < scene.info.height; ++y) {
+        for (int x = 0; x < scene.info.width; ++x) {
+            Pose center = from_truck_frame(truck, Pose{
+                scene.info.origin_x + (x + 0.5) * resolution, scene.info.origin_y + (y + 0.5) * resolution, 0.0
+            });
+            // Half extent of the turned cell along the world axes.
+            double extent = (std::abs(cs) + std::abs(sn)) * resolution / 2;
+            int x0 = static_cast<int>(std::floor((center.x - extent - world.info.origin_x) / resolution));
+            int x1 = static_cast<int>(std::floor((center.x + extent - world.info.origin_x) / resolution));
+            int y0 = static_cast<int>(std::floor((center.y - extent - world.info.origin_y) / resolution));
+            int y1 = static_cast<int>(std::floor((center.y + extent - world.info.origin_y) / resolution));
+            bool occupied = false;
+            for (int cy = y0; cy <= y1 && !occupied; ++cy) {
+                for (int cx = x0; cx <= x1 && !occupied; ++cx) {
+                    bool inside = cx >= 0 && cy >= 0 && cx < world.info.width && cy < world.info.height;
+                    if (inside && world.cells[static_cast<size_t>(cy) * world.info.width + cx] == 0) {
+                        continue;
+                    }
+                    // The squares are apart if they are along an edge direction of either one.
+                    double dx = world.info.origin_x + (cx + 0.5) * resolution - center.x;
+                    double dy = world.info.origin_y + (cy + 0.5) * resolution - center.y;
+                    double limit = (1.0 + std::abs(cs) + std::abs(sn)) * resolution / 2;
+                    occupied = std::abs(dx) < limit && std::abs(dy) < limit && std::abs(dx * cs + dy * sn) < limit &&
+                               std::abs(-dx * sn + dy * cs) < limit;
+                }
+            }
+            scene.cells[static_cast<size_t>(y) * scene.info.width + x] = occupied ? 100 : 0;
+        }
+    }
+    return scene;
+}
+
+nav_msgs::msg::Odometry to_odometry(const Pose& pose, double velocity) {
+    nav_msgs::msg::Odometry odometry;
+    odometry.pose.pose.position.x = pose.x;
+    odometry.pose.pose.position.y = pose.y;
+    odometry.pose.pose.orientation.z = std::sin(pose.theta / 2);
+    odometry.pose.pose.orientation.w = std::cos(pose.theta / 2);
+    odometry.twist.twist.linear.x = velocity;
+    return odometry;
+}
+
+std::vector<geometry_msgs::msg::PoseStamped> to_poses(const std::vector<Pose>& path) {
+    std::vector<geometry_msgs::msg::PoseStamped> poses(path.size());
+    for (size_t i = 0; i < path.size(); ++i) {
+        poses[i].pose.position.x = path[i].x;
+        poses[i].pose.position.y = path[i].y;
+    }
+    return poses;
+}
+
+Episode run_episode(
+    const Options& options, planning_core::Planner& planner, double resolution, Pose initial,
+    const std::vector<Circle>& footprint, const pure_pursuit::Parameters& params, uint64_t seed
+) {
+    using Clock = std::chrono::steady_clock;
+    using microseconds = std::chrono::duration<double, std::micro>;
+    auto wall_start = Clock::now();
+
+    std::mt19937_64 engine{seed};
+    std::uniform_real_distribution<double> angle(-M_PI, M_PI);
+    std::uniform_real_distribution<double> distance(options.radius / 2, options.radius * 0.8);
+    double a = angle(engine);
+    double d = distance(engine);
+    Pose target{d * std::cos(a), d * std::sin(a), 0.0};
+    planning_core::RandomScene random = planning_core::make_random_scene(
+        engine, options.radius, options.density, resolution, target
+    );
+    Scene scene{random.info, std::move(random.cells)};
+
+    Episode episode;
+    pure_pursuit::Controller controller(params);
+    std::vector<Pose> path;
+    Pose truck{};
+    double velocity = 0.0;
+
+    // Planned in the frame of the truck from the configured initial pose, as on the truck. Target
+    // heading is the quarter turn closest to its bearing, which the motion primitives can reach.
+    auto replan = [&]() {
+        auto start = Clock::now();
+        Scene view = truck_scene(scene, truck);
+        planner.set_scene(view.info, view.cells.data());
+        Pose goal = to_truck_frame(truck, target);
+        double quarter = M_PI / 2;
+        goal.theta = std::fmod(std::fmod(std::round(std::atan2(goal.y, goal.x) / quarter), 4.0) + 4.0, 4.0) * quarter;
+        planning_core::PlanResult result = planner.plan(initial, goal);
+        episode.plan_us.push_back(microseconds(Clock::now() - start).count());
+        ++episode.replans;
+        if (result.status != PlanStatus::Found) {
+            ++episode.failed_plans;
+            return false;
+        }
+        path.clear();
+        for (const Pose& pose : result.path) {
+            path.push_back(from_truck_frame(truck, to_truck_frame(initial, pose)));
+        }
+        controller.set_path(pure_pursuit::Trajectory(to_poses(path)));
+        return true;
+    };
+
+    if (!replan()) {
+        episode.outcome = Outcome::Unreachable;
+        episode.wall_s = std::chrono::duration<double>(Clock::now() - wall_start).count();
+        return episode;
+    }
+
+    double dt = 1.0 / options.control_rate;
+    size_t steps = static_cast<size_t>(options.duration * options.control_rate);
+    size_t replan_steps = std::max<size_t>(1, static_cast<size_t>(std::lround(options.replan_period * options.control_rate)));
+    episode.control_us.reserve(steps);
+    bool lost = false;
+    for (size_t step = 1; step <= steps; ++step) {
+        if (step % replan_steps == 0 || lost) {
+            replan();
+        }
+
+        auto start = Clock::now();
+        auto command = controller.get_motion(to_odometry(truck, velocity), dt);
+        episode.control_us.push_back(microseconds(Clock::now() - start).count());
+
+        lost = !command;
+        episode.lost_ticks += lost;
+        velocity = command ? command->velocity.linear.x : 0.0;
+        double turn_rate = command ? command->velocity.angular.z : 0.0;
+
+        // Constant velocity and turn rate over the tick move the truck along an arc.
+        double half_turn = turn_rate * dt / 2;
+        double chord = std::abs(half_turn) > 1e-9 ? std::sin(half_turn) / half_turn * velocity * dt : velocity * dt;
+        truck.x += chord * std::cos(truck.theta + half_turn);
+        truck.y += chord * std::sin(truck.theta + half_turn);
+        truck.theta = std::remainder(truck.theta + turn_rate * dt, 2 * M_PI);
+        episode.simulated_s = step * dt;
+
+        double error = distance_to_path(path, truck.x, truck.y);
+        episode.error_sum += error;
+        episode.error_max = std::max(episode.error_max, error);
+        ++episode.ticks;
+
+        if (collides(scene, footprint, truck)) {
+            episode.outcome = Outcome::Collided;
+            break;
+        }
+        // Paths end on the center of the lattice cell of the target in the turned scene, up to half
+        // a diagonal from it, and the truck comes to rest near rather than on the end.
+        if (std::hypot(truck.x - target.x, truck.y - target.y) <= resolution * std::sqrt(2.0)) {
+            episode.outcome = Outcome::Reached;
+            break;
+        }
+    }
+    episode.wall_s = std::chrono::duration<double>(Clock::now() - wall_start).count();
+    return episode;
+}
+
+void usage() {
+    std::fprintf(
+        stderr,
+        "usage: simulator <config.json> [--episodes N] [--threads N] [--seed N] [--duration SECONDS]\n"
+        "                 [--radius METERS] [--density FRACTION] [--replan-period SECONDS] [--control-rate HZ]\n"
+        "                 [--min-reachable FRACTION]\n"
+    );
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            positional.push_back(arg);
+            continue;
+        }
+        if (i + 1 == argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--episodes") {
+            options.episodes = std::stoul(value);
+        } else if (arg == "--threads") {
+            options.threads = std::max(1ul, std::stoul(value));
+        } else if (arg == "--seed") {
+            options.seed = std::stoull(value);
+        } else if (arg == "--duration") {
+            options.duration = std::stod(value);
+        } else if (arg == "--radius") {
+            options.radius = std::stod(value);
+        } else if (arg == "--density") {
+            options.density = std::stod(value);
+        } else if (arg == "--replan-period") {
+            options.replan_period = std::stod(value);
+        } else if (arg == "--control-rate") {
+            options.control_rate = std::stod(value);
+        } else if (arg == "--min-reachable") {
+            options.min_reachable = std::stod(value);
+        } else {
+            return false;
+        }
+    }
+    if (positional.size() != 1 || options.control_rate <= 0.0) {
+        return false;
+    }
+    options.config_path = positional[0];
+    return true;
+}
+
+// Value below which the given fraction of the sorted values lies.
+double percentile(const std::vector<double>& sorted, double fraction) {
+    return sorted[static_cast<size_t>(fraction * (sorted.size() - 1))];
+}
+
+void print_distribution(const char* name, std::vector<double> latencies) {
+    if (latencies.empty()) {
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::printf(
+        "%-8s p50 %9.1f us  p90 %9.1f us  p99 %9.1f us  max %9.1f us\n", name, percentile(latencies, 0.5),
+        percentile(latencies, 0.9), percentile(latencies, 0.99), latencies.back()
+    );
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        if (!parse_options(argc, argv, options)) {
+            usage();
+            return 2;
+        }
+    } catch (const std::exception&) {
+        usage();
+        return 2;
+    }
+
+    try {
+        std::ifstream config_stream(options.config_path);
+        nlohmann::json config = nlohmann::json::parse(config_stream);
+        double resolution = config["lattice"]["resolution"];
+        Pose initial{config["initial"]["x"], config["initial"]["y"], config["initial"]["theta"]};
+        std::vector<Circle> footprint = footprint_from_json(config["footprint"]);
+        // Controller defaults of the node.
+        pure_pursuit::Parameters params{1.0, 0.5, 1.0, 1.0};
+
+        std::vector<Episode> episodes(options.episodes);
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        std::string error;
+        auto worker = [&]() {
+            try {
+                planning_core::Planner planner{config};
+                size_t i;
+                while ((i = next.fetch_add(1)) < options.episodes && !failed) {
+                    episodes[i] = run_episode(
+                        options, planner, resolution, initial, footprint, params, options.seed + i
+                    );
+                }
+            } catch (const std::exception& e) {
+                if (!failed.exchange(true)) {
+                    error = e.what();
+                }
+            }
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < options.threads; ++i) {
+            workers.emplace_back(worker);
+        }
+        for (std::thread& thread : workers) {
+            thread.join();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (failed) {
+            std::fprintf(stderr, "simulation failed: %s\n", error.c_str());
+            return 2;
+        }
+
+        size_t outcomes[4] = {};
+        double simulated = 0.0;
+        double busy = 0.0;
+        size_t replans = 0;
+        size_t failed_plans = 0;
+        size_t lost_ticks = 0;
+        size_t ticks = 0;
+        double error_sum = 0.0;
+        double error_max = 0.0;
+        std::vector<double> control_us;
+        std::vector<double> plan_us;
+        for (size_t i = 0; i < episodes.size(); ++i) {
+            const Episode& episode = episodes[i];
+            ++outcomes[static_cast<int>(episode.outcome)];
+            if (episode.outcome == Outcome::Collided) {
+                std::printf("collision: episode %zu seed %lu at %.2f s\n", i, static_cast<unsigned long>(options.seed + i), episode.simulated_s);
+            } else if (episode.outcome == Outcome::TimedOut) {
+                std::printf("timeout: episode %zu seed %lu\n", i, static_cast<unsigned long>(options.seed + i));
+            }
+            simulated += episode.simulated_s;
+            busy += episode.wall_s;
+            replans += episode.replans;
+            failed_plans += episode.failed_plans;
+            lost_ticks += episode.lost_ticks;
+            ticks += episode.ticks;
+            error_sum += episode.error_sum;
+            error_max = std::max(error_max, episode.error_max);
+            control_us.insert(control_us.end(), episode.control_us.begin(), episode.control_us.end());
+            plan_us.insert(plan_us.end(), episode.plan_us.begin(), episode.plan_us.end());
+        }
+
+        std::printf(
+            "%zu episodes on %zu threads in %.2f s: %zu reached, %zu collided, %zu timed out, %zu unreachable\n",
+            episodes.size(), options.threads, elapsed.count(), outcomes[static_cast<int>(Outcome::Reached)],
+            outcomes[static_cast<int>(Outcome::Collided)], outcomes[static_cast<int>(Outcome::TimedOut)],
+            outcomes[static_cast<int>(Outcome::Unreachable)]
+        );
+        std::printf(
+            "%.1f simulated s, %.1f simulated s per wall s, %.1f per thread\n", simulated, simulated / elapsed.count(),
+            busy > 0.0 ? simulated / busy : 0.0
+        );
+        std::printf(
+            "tracking error mean %.3f m max %.3f m, %zu replans, %zu failed, %zu ticks without a target\n",
+            ticks > 0 ? error_sum / ticks : 0.0, error_max, replans, failed_plans, lost_ticks
+        );
+        print_distribution("control", control_us);
+        print_distribution("plan", plan_us);
+        bool regressed = outcomes[static_cast<int>(Outcome::Collided)] + outcomes[static_cast<int>(Outcome::TimedOut)] > 0;
+        size_t reachable = episodes.size() - outcomes[static_cast<int>(Outcome::Unreachable)];
+        if (reachable < options.min_reachable * episodes.size()) {
+            std::printf(
+                "only %zu of %zu episodes reachable, below the minimum of %.2f\n", reachable, episodes.size(),
+                options.min_reachable
+            );
+            regressed = true;
+        }
+        return regressed ? 1 : 0;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "simulation failed: %s\n", e.what());
+        return 2;
+    }
+}
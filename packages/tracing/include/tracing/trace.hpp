@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+
+// Spans and instant events recorded into per-thread ring buffers and written by a background
+// thread as Chrome trace JSON, which chrome://tracing and ui.perfetto.dev both open.
+//
+// Tracing is off unless start is called, typically through start_from_env from a node
+// constructor. While it's off every call below is a single relaxed load. Names must be string
+// literals or otherwise outlive the trace, they are stored as pointers.
+//
+// Events of one message carry its id, the same id in every node, so a scene can be followed from
+// the unwrapping node through the planner to the controller. Events sharing an id are linked by
+// flow arrows in Perfetto.
+namespace tracing {
+
+namespace detail {
+
+extern std::atomic<bool> enabled;
+
+int64_t now_ns();
+void record(const char* name, uint64_t id, int64_t start_ns, int64_t duration_ns);
+
+}
+
+inline bool enabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+// Starts writing the trace to the file, later calls have no effect. Throws std::runtime_error
+// if the file can't be opened. Remaining events are written at exit or by stop.
+void start(const std::string& path);
+
+// Starts tracing if the TRUCK_TRACE variable is set, into the file it names with ".<pid>.json"
+// appended, so processes of one launch don't overwrite each other.
+void start_from_env();
+
+// Writes the remaining events and closes the trace.
+void stop();
+
+// Names the calling thread in the trace. While tracing is off the name is only kept for later.
+void name_thread(const std::string& name);
+
+// Event of no duration.
+inline void instant(const char* name, uint64_t id = 0) {
+    if (enabled()) {
+        detail::record(name, id, detail::now_ns(), -1);
+    }
+}
+
+// Event from construction to destruction on the constructing thread.
+class Span {
+public:
+    explicit Span(const char* name, uint64_t id = 0) : name(name), id(id) {
+        if (enabled()) {
+            start_ns = detail::now_ns();
+        }
+    }
+
+    ~Span() {
+        if (start_ns >= 0) {
+            detail::record(name, id, start_ns, detail::now_ns() - start_ns);
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    // Id may be known only once the span has started, as for a message taken from a queue.
+    void set_id(uint64_t new_id) {
+        id = new_id;
+    }
+
+private:
+    const char* name;
+    uint64_t id;
+    int64_t start_ns = -1;
+};
+
+}
@@ -0,0 +1,273 @@
+#include "tracing/trace.hpp"
+
+#include <unistd.h>
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+namespace tracing {
+
+namespace detail {
+
+std::atomic<bool> enabled{false};
+
+// Monotonic clock is shared by the processes of a machine, so their traces line up.
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+}
+
+namespace {
+
+struct Event {
+    const char* name;
+    uint64_t id;
+    int64_t start_ns;
+    // Negative for instant events.
+    int64_t duration_ns;
+};
+
+// Written by its thread only and read by the flusher. Events that don't fit until the next
+// flush are dropped and counted, recording never waits.
+struct ThreadBuffer {
+    static constexpr uint64_t capacity = 4096;
+
+    std::array<Event, capacity> events;
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+    std::atomic<uint64_t> dropped{0};
+    // Cleared when the thread exits, the buffer is released once the flusher drained it.
+    std::atomic<bool> alive{true};
+
+    // Guarded by the tracer mutex.
+    uint32_t tid = 0;
+    std::string name;
+    bool name_written = false;
+};
+
+struct Tracer {
+    static constexpr auto flush_period = std::chrono::milliseconds(100);
+
+    std::once_flag started;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread flusher;
+
+    std::FILE* file = nullptr;
+    bool first_event = true;
+    int pid = 0;
+    uint32_t next_tid = 1;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+    void run() {
+        std::unique_lock<std::mutex> lock{mutex};
+        while (!stopping) {
+            wake.wait_for(lock, flush_period);
+            flush();
+        }
+    }
+
+    // Called with the mutex held.
+    void flush() {
+        if (!file) {
+            return;
+        }
+        for (auto it = buffers.begin(); it != buffers.end();) {
+            ThreadBuffer& buffer = **it;
+            if (!buffer.name.empty() && !buffer.name_written) {
+                write_thread_name(buffer);
+                buffer.name_written = true;
+            }
+
+            bool alive = buffer.alive.load(std::memory_order_acquire);
+            uint64_t head = buffer.head.load(std::memory_order_acquire);
+            uint64_t tail = buffer.tail.load(std::memory_order_relaxed);
+            for (; tail != head; ++tail) {
+                write_event(buffer.tid, buffer.events[tail % ThreadBuffer::capacity]);
+            }
+            buffer.tail.store(tail, std::memory_order_release);
+
+            uint64_t dropped = buffer.dropped.exchange(0, std::memory_order_relaxed);
+            if (dropped > 0) {
+                begin_event();
+                std::fprintf(
+                    file, "{\"name\":\"trace events dropped\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,"
+                    "\"pid\":%d,\"tid\":%u,\"args\":{\"count\":%lu}}",
+                    detail::now_ns() / 1e3, pid, buffer.tid, static_cast<unsigned long>(dropped)
+                );
+            }
+
+            it = alive ? it + 1 : buffers.erase(it);
+        }
+        std::fflush(file);
+    }
+
+    void begin_event() {
+        std::fputs(first_event ? "\n" : ",\n", file);
+        first_event = false;
+    }
+
+    void write_event(uint32_t tid, const Event& event) {
+        begin_event();
+        std::fprintf(file, "{\"name\":\"");
+        write_escaped(event.name);
+        if (event.duration_ns < 0) {
+            std::fprintf(file, "\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f", event.start_ns / 1e3);
+        } else {
+            std::fprintf(file, "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f", event.start_ns / 1e3, event.duration_ns / 1e3);
+        }
+        std::fprintf(file, ",\"pid\":%d,\"tid\":%u", pid, tid);
+        if (event.id != 0) {
+            unsigned long id = static_cast<unsigned long>(event.id);
+            std::fprintf(
+                file, ",\"args\":{\"id\":%lu},\"bind_id\":\"%lx\",\"flow_in\":true,\"flow_out\":true", id, id
+            );
+        }
+        std::fputc('}', file);
+    }
+
+    void write_thread_name(const ThreadBuffer& buffer) {
+        begin_event();
+        std::fprintf(
+            file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"", pid, buffer.tid
+        );
+        write_escaped(buffer.name.c_str());
+        std::fputs("\"}}", file);
+    }
+
+    void write_escaped(const char* text) {
+        for (; *text; ++text) {
+            if (*text == '"' || *text == '\\') {
+                std::fputc('\\', file);
+            }
+            std::fputc(static_cast<unsigned char>(*text) < 0x20 ? ' ' : *text, file);
+        }
+    }
+};
+
+// Never destroyed, threads may still record while static objects are torn down at exit.
+Tracer& tracer() {
+    static Tracer* instance = new Tracer;
+    return *instance;
+}
+
+struct BufferOwner {
+    std::shared_ptr<ThreadBuffer> buffer;
+
+    ~BufferOwner() {
+        if (buffer) {
+            buffer->alive.store(false, std::memory_order_release);
+        }
+    }
+};
+
+// Kept apart from the buffer, so naming a thread while tracing is off doesn't allocate one.
+std::string& local_name() {
+    thread_local std::string name;
+    return name;
+}
+
+ThreadBuffer& local_buffer() {
+    thread_local BufferOwner owner;
+    if (!owner.buffer) {
+        owner.buffer = std::make_shared<ThreadBuffer>();
+        Tracer& t = tracer();
+        std::lock_guard<std::mutex> lock{t.mutex};
+        owner.buffer->tid = t.next_tid++;
+        owner.buffer->name = local_name();
+        t.buffers.push_back(owner.buffer);
+    }
+    return *owner.buffer;
+}
+
+}
+
+namespace detail {
+
+void record(const char* name, uint64_t id, int64_t start_ns, int64_t duration_ns) {
+    ThreadBuffer& buffer = local_buffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    if (head - buffer.tail.load(std::memory_order_acquire) == ThreadBuffer::capacity) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[head % ThreadBuffer::capacity] = Event{name, id, start_ns, duration_ns};
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+}
+
+void start(const std::string& path) {
+    Tracer& t = tracer();
+    std::call_once(t.started, [&t, &path]() {
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (!file) {
+            throw std::runtime_error("Can't open trace file " + path);
+        }
+        // Closing bracket is optional in the array format, so a trace cut short still opens.
+        std::fputs("[", file);
+        {
+            std::lock_guard<std::mutex> lock{t.mutex};
+            t.file = file;
+            t.pid = static_cast<int>(getpid());
+        }
+        t.flusher = std::thread{&Tracer::run, &t};
+        std::atexit(stop);
+        detail::enabled.store(true, std::memory_order_relaxed);
+    });
+}
+
+void start_from_env() {
+    const char* path = std::getenv("TRUCK_TRACE");
+    if (path && *path) {
+        start(std::string(path) + "." + std::to_string(getpid()) + ".json");
+    }
+}
+
+void stop() {
+    Tracer& t = tracer();
+    detail::enabled.store(false, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock{t.mutex};
+        t.stopping = true;
+    }
+    t.wake.notify_all();
+    if (t.flusher.joinable()) {
+        t.flusher.join();
+    }
+
+    std::lock_guard<std::mutex> lock{t.mutex};
+    if (t.file) {
+        t.flush();
+        std::fputs("\n]\n", t.file);
+        std::fclose(t.file);
+        t.file = nullptr;
+    }
+}
+
+void name_thread(const std::string& name) {
+    local_name() = name;
+    // Picked up with the buffer if the thread records once tracing starts.
+    if (!enabled()) {
+        return;
+    }
+    ThreadBuffer& buffer = local_buffer();
+    std::lock_guard<std::mutex> lock{tracer().mutex};
+    buffer.name = name;
+    buffer.name_written = false;
+}
+
+}
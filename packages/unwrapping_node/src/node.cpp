@@ -0,0 +1,188 @@
+#include "geometry_msgs/msg/pose.hpp"
+#include "nav_msgs/msg/occupancy_grid.hpp"
+#include "nav_msgs/msg/path.hpp"
+#include "planning_interfaces/msg/path.hpp"
+#include "planning_interfaces/msg/random_seed.hpp"
+#include "planning_interfaces/msg/scene.hpp"
+#include "planning_interfaces/msg/scene_delta.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
+#include "tf2_geometry_msgs/tf2_geometry_msgs.h"
+#include "tf2/LinearMath/Quaternion.h"
+#include "tracing/trace.hpp"
+
+
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <utility>
+
+
+namespace unwrapping_node {
+
+using std::placeholders::_1;
+
+struct UnwrappingNode : public rclcpp::Node {
+    explicit UnwrappingNode(const rclcpp::NodeOptions& options) : Node("UnwrappingNode", options) {
+        tracing::start_from_env();
+        path_subscription = create_subscription<planning_interfaces::msg::Path>(
+            "path", 10, std::bind(&UnwrappingNode::new_path_callback, this, _1)
+        );
+        raw_path_publisher = create_publisher<nav_msgs::msg::Path>("raw_path", 10);
+
+        scene_subscription = create_subscription<planning_interfaces::msg::Scene>(
+            "scene", 10, std::bind(&UnwrappingNode::new_scene_callback, this, _1)
+        );
+        raw_occupancy_grid_publisher = create_publisher<nav_msgs::msg::OccupancyGrid>("raw_occupancy_grid", 10);
+
+        random_scene_subscriber = create_subscription<planning_interfaces::msg::RandomSeed>(
+            "random_scene", 10, std::bind(&UnwrappingNode::new_random_scene_callback, this, _1)
+        );
+        scene_publisher = create_publisher<planning_interfaces::msg::Scene>("scene", 10);
+        scene_delta_publisher = create_publisher<planning_interfaces::msg::SceneDelta>("scene_delta", 10);
+
+        // Random scene covers [-radius, radius] meters along both axes.
+        random_scene_radius = declare_parameter<double>("random_scene_radius", 20.0);
+        random_scene_resolution = declare_parameter<double>("random_scene_resolution", 1.0);
+        // Scenes differing in few cells from the last one go out as deltas, with a full keyframe in between.
+        scene_keyframe_interval = declare_parameter<int>("scene_keyframe_interval", 10);
+    }
+
+private:
+    // Messages are owned here, so the payload is moved out instead of copied.
+    void new_path_callback(planning_interfaces::msg::Path::UniquePtr message) const {
+        RCLCPP_INFO(get_logger(), "New path: created_at=%ld", message->created_at);
+        tracing::instant("path received", message->scene_id);
+        raw_path_publisher->publish(std::make_unique<nav_msgs::msg::Path>(std::move(message->path)));
+    }
+
+    void new_scene_callback(planning_interfaces::msg::Scene::UniquePtr message) const {
+        RCLCPP_INFO(get_logger(), "New scene: created_at=%ld", message->created_at);
+        raw_occupancy_grid_publisher->publish(
+            std::make_unique<nav_msgs::msg::OccupancyGrid>(std::move(message->occupancy_grid))
+        );
+    }
+
+    // temporary random scene generator for debug
+    void new_random_scene_callback(const planning_interfaces::msg::RandomSeed::SharedPtr message) {
+        RCLCPP_INFO(get_logger(), "Generating random scene: seed=%ld, probability=%.3f", message->seed, message->probability);
+        auto scene = std::make_unique<planning_interfaces::msg::Scene>();
+        tracing::Span span{"scene generated", last_scene_id + 1};
+
+        std::mt19937_64 engine{message->seed};
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        
+        scene->created_at = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+
+        int dx = static_cast<int>(std::lround(random_scene_radius / random_scene_resolution));
+        int dy = dx;
+        float resolution = static_cast<float>(random_scene_resolution);
+        scene->occupancy_grid.info.resolution = resolution;
+        scene->occupancy_grid.info.width = 2 * dx + 1;
+        scene->occupancy_grid.info.height = 2 * dy + 1;
+        scene->occupancy_grid.data.reserve(
+            static_cast<size_t>(scene->occupancy_grid.info.width) * scene->occupancy_grid.info.height
+        );
+        
+        geometry_msgs::msg::Pose origin;
+        origin.position.x = -(dx + 0.5) * resolution;
+        origin.position.y = -(dy + 0.5) * resolution;
+        tf2::Quaternion quart;
+        quart.setRPY(0.0, 0.0, 0.0);
+        origin.orientation = tf2::toMsg(quart);
+        scene->occupancy_grid.info.origin = origin;
+
+        for (int y = -dy; y <= dy; ++y) {
+            for (int x = -dx; x <= dx; ++x) {
+                if (dist(engine) < message->probability) {
+                    scene->occupancy_grid.data.push_back(static_cast<int8_t>(100));
+                } else {
+                    scene->occupancy_grid.data.push_back(static_cast<int8_t>(0));
+                }
+            }
+        }
+
+        scene->id = ++last_scene_id;
+        auto delta = std::make_unique<planning_interfaces::msg::SceneDelta>();
+        if (deltas_since_keyframe < scene_keyframe_interval &&
+            encode_delta(last_grid, scene->occupancy_grid, *delta)) {
+            delta->created_at = scene->created_at;
+            delta->base_id = scene->id - 1;
+            delta->id = scene->id;
+            ++deltas_since_keyframe;
+            last_grid = scene->occupancy_grid;
+            scene_delta_publisher->publish(std::move(delta));
+            tracing::instant("scene delta published", scene->id);
+            raw_occupancy_grid_publisher->publish(
+                std::make_unique<nav_msgs::msg::OccupancyGrid>(std::move(scene->occupancy_grid))
+            );
+            return;
+        }
+        deltas_since_keyframe = 0;
+        last_grid = scene->occupancy_grid;
+        uint64_t scene_id = scene->id;
+        scene_publisher->publish(std::move(scene));
+        tracing::instant("scene published", scene_id);
+    }
+
+    // Lists the cells that differ, runs of changed cells with equal values as a single entry.
+    // Returns false if the grids differ in geometry or the delta isn't much smaller than a grid.
+    static bool encode_delta(
+        const nav_msgs::msg::OccupancyGrid& previous,
+        const nav_msgs::msg::OccupancyGrid& next,
+        planning_interfaces::msg::SceneDelta& delta
+    ) {
+        static constexpr size_t index_bytes = sizeof(uint32_t) + sizeof(int8_t);
+        static constexpr size_t run_bytes = 2 * sizeof(uint32_t) + sizeof(int8_t);
+
+        if (previous.info != next.info || previous.data.size() != next.data.size()) {
+            return false;
+        }
+        size_t size = next.data.size();
+        for (size_t i = 0; i < size;) {
+            if (previous.data[i] == next.data[i]) {
+                ++i;
+                continue;
+            }
+            size_t end = i + 1;
+            while (end < size && previous.data[end] != next.data[end] && next.data[end] == next.data[i]) {
+                ++end;
+            }
+            if (end - i > 1) {
+                delta.run_starts.push_back(static_cast<uint32_t>(i));
+                delta.run_lengths.push_back(static_cast<uint32_t>(end - i));
+                delta.run_values.push_back(next.data[i]);
+            } else {
+                delta.indices.push_back(static_cast<uint32_t>(i));
+                delta.values.push_back(next.data[i]);
+            }
+            i = end;
+        }
+        return 2 * (delta.indices.size() * index_bytes + delta.run_starts.size() * run_bytes) < size;
+    }
+
+    rclcpp::Subscription<planning_interfaces::msg::Path>::SharedPtr path_subscription;
+    rclcpp::Publisher<nav_msgs::msg::Path>::SharedPtr raw_path_publisher;
+    
+    rclcpp::Subscription<planning_interfaces::msg::Scene>::SharedPtr scene_subscription;
+    rclcpp::Publisher<nav_msgs::msg::OccupancyGrid>::SharedPtr raw_occupancy_grid_publisher;
+    
+    rclcpp::Subscription<planning_interfaces::msg::RandomSeed>::SharedPtr random_scene_subscriber;
+    rclcpp::Publisher<planning_interfaces::msg::Scene>::SharedPtr scene_publisher;
+    rclcpp::Publisher<planning_interfaces::msg::SceneDelta>::SharedPtr scene_delta_publisher;
+
+    double random_scene_radius;
+    double random_scene_resolution;
+    int scene_keyframe_interval;
+
+    uint64_t last_scene_id = 0;
+    nav_msgs::msg::OccupancyGrid last_grid;
+    int deltas_since_keyframe = 0;
+};
+
+}
+
+RCLCPP_COMPONENTS_REGISTER_NODE(unwrapping_node::UnwrappingNode)